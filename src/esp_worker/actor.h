@@ -0,0 +1,362 @@
+#pragma once
+
+#include "worker.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+extern "C" {
+#include "esp_heap_caps.h"
+}
+
+// Type-independent part of an actor mailbox: wake-up, stop flag and the statistics reported in
+// JobDiag.
+class WorkerMailboxBase {
+  public:
+	WorkerMailboxBase() {
+		_space = xSemaphoreCreateBinaryStatic(&_spaceBuffer);
+	}
+	virtual ~WorkerMailboxBase() {
+		if (_space) {
+			vSemaphoreDelete(_space);
+		}
+	}
+
+	size_t capacity() const {
+		return _mask + 1;
+	}
+	size_t depth() const {
+		size_t enqueued = _enqueuePos.load(std::memory_order_acquire);
+		size_t dequeued = _dequeuePos.load(std::memory_order_acquire);
+		return enqueued - dequeued;
+	}
+	uint32_t dropped() const {
+		return _dropped.load(std::memory_order_relaxed);
+	}
+	uint32_t delivered() const {
+		return _delivered.load(std::memory_order_relaxed);
+	}
+	bool stopping() const {
+		return _stopping.load(std::memory_order_acquire);
+	}
+
+	// The actor finishes the messages already queued, then returns.
+	void stop() {
+		_stopping.store(true, std::memory_order_release);
+		wake();
+		wakePoster();
+	}
+
+	// Called before the actor's task goes away, when run() returns or the job is destroyed:
+	// refuses further posts, waits out producers still notifying the task and fails the posters
+	// blocked on a full mailbox.
+	void close() {
+		_stopping.store(true);
+		_task.store(nullptr);
+		while (_notifying.load() > 0) {
+			vTaskDelay(1); // lets a preempted lower-priority producer finish its notify
+		}
+		wakePoster();
+	}
+
+  protected:
+	static size_t roundCapacity(size_t capacity) {
+		size_t rounded = 1;
+		while (rounded < capacity) {
+			rounded <<= 1;
+		}
+		return rounded;
+	}
+
+	// A producer that reads a null task pushed before the actor published its handle, so the
+	// actor's first drain picks the message up, or after close(). _notifying is raised before
+	// _task is read, so close() either hides the task or waits for the notify to finish.
+	void wake() {
+		_notifying.fetch_add(1);
+		TaskHandle_t task = _task.load();
+		if (task) {
+			xTaskNotifyGive(task);
+		}
+		_notifying.fetch_sub(1);
+	}
+	void wakeFromISR(BaseType_t *higherPriorityTaskWoken) {
+		_notifying.fetch_add(1);
+		TaskHandle_t task = _task.load();
+		if (task) {
+			vTaskNotifyGiveFromISR(task, higherPriorityTaskWoken);
+		}
+		_notifying.fetch_sub(1);
+	}
+	// Posters blocked on a full mailbox sleep on _space. Every pop and stop() gives it and a woken
+	// poster passes it on, so one give can wake them all in turn; posters re-check the ring
+	// because the give may be stale.
+	void wakePoster() {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (_blockedPosters.load() > 0 && _space) {
+			xSemaphoreGive(_space);
+		}
+	}
+
+	size_t _mask = 0;
+	std::atomic<size_t> _enqueuePos{0};
+	std::atomic<size_t> _dequeuePos{0};
+	std::atomic<uint32_t> _dropped{0};
+	std::atomic<uint32_t> _delivered{0};
+	std::atomic<bool> _stopping{false};
+	std::atomic<TaskHandle_t> _task{nullptr};
+	std::atomic<uint32_t> _notifying{0};
+	std::atomic<uint32_t> _blockedPosters{0};
+	SemaphoreHandle_t _space = nullptr;
+	StaticSemaphore_t _spaceBuffer{};
+};
+
+// Bounded MPSC ring (Vyukov sequence cells). Producers claim a cell with a CAS and move the
+// message into it; the actor hands the message to its handler in place, so nothing is copied.
+// Lock- and allocation-free on both sides, which makes postFromISR() usable from an ISR as long
+// as Msg's move constructor is.
+template <typename Msg> class WorkerMailbox : public WorkerMailboxBase {
+  public:
+	explicit WorkerMailbox(size_t capacity) {
+		size_t rounded = roundCapacity(capacity);
+		void *raw = heap_caps_malloc(rounded * sizeof(Cell), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+		if (!raw) {
+			return;
+		}
+		_cells = static_cast<Cell *>(raw);
+		for (size_t i = 0; i < rounded; ++i) {
+			new (&_cells[i]) Cell();
+			_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		_mask = rounded - 1;
+	}
+
+	~WorkerMailbox() override {
+		if (!_cells) {
+			return;
+		}
+		while (consumeOne([](Msg &&) {})) {
+		}
+		for (size_t i = 0; i <= _mask; ++i) {
+			_cells[i].~Cell();
+		}
+		heap_caps_free(_cells);
+	}
+
+	WorkerMailbox(const WorkerMailbox &) = delete;
+	WorkerMailbox &operator=(const WorkerMailbox &) = delete;
+
+	bool valid() const {
+		return _cells != nullptr;
+	}
+
+	bool tryPush(Msg &&message) {
+		if (!_cells || stopping()) {
+			return false;
+		}
+		size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+		Cell *cell = nullptr;
+		while (true) {
+			cell = &_cells[pos & _mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0) {
+				if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+					break;
+				}
+			} else if (diff < 0) {
+				return false; // full
+			} else {
+				pos = _enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+		new (cell->storage) Msg(std::move(message));
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool post(Msg &&message, TickType_t ticks) {
+		const TickType_t start = xTaskGetTickCount();
+		bool waited = false;
+		while (!tryPush(std::move(message))) {
+			// Counted before the retry, so a pop that frees a cell after it gives _space.
+			_blockedPosters.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const bool pushed = tryPush(std::move(message));
+			bool woken = false;
+			if (!pushed && !stopping() && _space) {
+				waited = true;
+				const TickType_t elapsed = xTaskGetTickCount() - start;
+				TickType_t remaining = ticks;
+				if (ticks != portMAX_DELAY) {
+					remaining = elapsed < ticks ? ticks - elapsed : 0;
+				}
+				woken = remaining > 0 && xSemaphoreTake(_space, remaining) == pdTRUE;
+			}
+			_blockedPosters.fetch_sub(1);
+			if (pushed) {
+				break;
+			}
+			if (!woken) {
+				_dropped.fetch_add(1, std::memory_order_relaxed);
+				if (stopping()) {
+					wakePoster(); // hand the stop() wake-up on
+				}
+				return false;
+			}
+		}
+		if (waited) {
+			wakePoster(); // another cell may have freed up meanwhile
+		}
+		wake();
+		return true;
+	}
+
+	bool tryPost(Msg &&message) {
+		if (!tryPush(std::move(message))) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		wake();
+		return true;
+	}
+
+	bool postFromISR(Msg &&message, BaseType_t *higherPriorityTaskWoken) {
+		if (!tryPush(std::move(message))) {
+			_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		wakeFromISR(higherPriorityTaskWoken);
+		return true;
+	}
+
+	// Actor task body: drain, then sleep on the task notification until stop().
+	template <typename Handler> void run(Handler &handler) {
+		_task.store(xTaskGetCurrentTaskHandle());
+		while (true) {
+			while (consumeOne(handler)) {
+			}
+			if (stopping()) {
+				while (consumeOne(handler)) {
+				}
+				close();
+				return;
+			}
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		}
+	}
+
+  private:
+	struct Cell {
+		std::atomic<size_t> sequence{0};
+		alignas(Msg) unsigned char storage[sizeof(Msg)];
+	};
+
+	template <typename Handler> bool consumeOne(Handler &&handler) {
+		if (!_cells) {
+			return false;
+		}
+		size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+		Cell &cell = _cells[pos & _mask];
+		if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+			return false;
+		}
+		Msg *message = std::launder(reinterpret_cast<Msg *>(cell.storage));
+		handler(std::move(*message));
+		message->~Msg();
+		cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+		_dequeuePos.store(pos + 1, std::memory_order_release);
+		_delivered.fetch_add(1, std::memory_order_relaxed);
+		wakePoster();
+		return true;
+	}
+
+	Cell *_cells = nullptr;
+};
+
+// Handle returned by ESPWorker::spawnActor(). Copies share the actor.
+template <typename Msg> class WorkerActor {
+  public:
+	WorkerActor() = default;
+
+	explicit operator bool() const {
+		return _error == WorkerError::None && _mailbox && _handler;
+	}
+	WorkerError error() const {
+		return _error;
+	}
+	const char *message() const {
+		return _message;
+	}
+	std::shared_ptr<WorkerHandler> handler() const {
+		return _handler;
+	}
+
+	// Blocks up to ticks while the mailbox is full. Failed posts count as drops.
+	bool post(Msg message, TickType_t ticks = portMAX_DELAY) {
+		return _mailbox && _mailbox->post(std::move(message), ticks);
+	}
+	bool tryPost(Msg message) {
+		return _mailbox && _mailbox->tryPost(std::move(message));
+	}
+	// Never blocks; pass the flag on to portYIELD_FROM_ISR().
+	bool postFromISR(Msg &&message, BaseType_t *higherPriorityTaskWoken) {
+		return _mailbox && _mailbox->postFromISR(std::move(message), higherPriorityTaskWoken);
+	}
+
+	void stop() {
+		if (_mailbox) {
+			_mailbox->stop();
+		}
+	}
+	bool wait(TickType_t ticks = portMAX_DELAY) {
+		return _handler && _handler->wait(ticks);
+	}
+
+  private:
+	friend class ESPWorker;
+
+	WorkerError _error{WorkerError::None};
+	const char *_message{nullptr};
+	std::shared_ptr<WorkerMailbox<Msg>> _mailbox{};
+	std::shared_ptr<WorkerHandler> _handler{};
+};
+
+template <typename Msg, typename Handler>
+WorkerActor<Msg>
+ESPWorker::spawnActor(Handler handler, size_t capacity, const WorkerConfig &config) {
+	WorkerActor<Msg> actor;
+	if (capacity == 0 || capacity > kESPWorkerMaxMailboxCapacity) {
+		notifyError(WorkerError::InvalidConfig);
+		actor._error = WorkerError::InvalidConfig;
+		actor._message = "Mailbox capacity must be between 1 and kESPWorkerMaxMailboxCapacity";
+		return actor;
+	}
+	if (_config.staticAllocation) {
+		notifyError(WorkerError::InvalidConfig);
+		actor._error = WorkerError::InvalidConfig;
+		actor._message = "Actors allocate their mailbox, so static allocation mode rejects them";
+		return actor;
+	}
+
+	auto mailbox = std::make_shared<WorkerMailbox<Msg>>(capacity);
+	if (!mailbox->valid()) {
+		notifyError(WorkerError::NoMemory);
+		actor._error = WorkerError::NoMemory;
+		actor._message = "Failed to allocate the actor mailbox in internal RAM";
+		return actor;
+	}
+
+	WorkerResult result = spawnActorJob(
+	    [mailbox, handler]() mutable { mailbox->run(handler); }, config, mailbox
+	);
+	actor._error = result.error;
+	actor._message = result.message;
+	if (result) {
+		actor._mailbox = std::move(mailbox);
+		actor._handler = std::move(result.handler);
+	}
+	return actor;
+}
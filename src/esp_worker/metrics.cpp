@@ -0,0 +1,261 @@
+#include "worker.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kMetricsLineBytes = 192;
+
+// Formats one line at a time into a stack buffer and hands it to the sink.
+class MetricsWriter {
+  public:
+	MetricsWriter(ESPWorker::MetricsSink sink, void *context) : _sink(sink), _context(context) {
+	}
+
+	[[gnu::format(printf, 2, 3)]] void line(const char *format, ...) {
+		char text[kMetricsLineBytes];
+		va_list args;
+		va_start(args, format);
+		int length = vsnprintf(text, sizeof(text) - 1, format, args);
+		va_end(args);
+		if (length < 0) {
+			return;
+		}
+		size_t size = static_cast<size_t>(length);
+		if (size > sizeof(text) - 2) {
+			size = sizeof(text) - 2; // keep the line terminated even when it was cut short
+		}
+		text[size++] = '\n';
+		_sink(text, size, _context);
+	}
+
+	void counter(const char *name, const char *help, uint32_t value) {
+		line("# TYPE %s counter", name);
+		line("# HELP %s %s", name, help);
+		line("%s_total %u", name, static_cast<unsigned>(value));
+	}
+
+	void gauge(const char *name, const char *help, uint32_t value) {
+		line("# TYPE %s gauge", name);
+		line("# HELP %s %s", name, help);
+		line("%s %u", name, static_cast<unsigned>(value));
+	}
+
+  private:
+	ESPWorker::MetricsSink _sink;
+	void *_context;
+};
+
+struct BufferSink {
+	char *buffer;
+	size_t capacity;
+	size_t length;
+};
+
+void appendToBuffer(const char *data, size_t length, void *context) {
+	auto *out = static_cast<BufferSink *>(context);
+	if (out->length + 1 < out->capacity) {
+		size_t room = out->capacity - 1 - out->length;
+		memcpy(out->buffer + out->length, data, length < room ? length : room);
+	}
+	out->length += length;
+}
+
+// Label values escape backslash, double quote and newline.
+void escapeLabel(const char *value, char *out, size_t capacity) {
+	size_t used = 0;
+	for (; *value && used + 2 < capacity; ++value) {
+		char c = *value;
+		if (c == '\\' || c == '"' || c == '\n') {
+			out[used++] = '\\';
+			c = c == '\n' ? 'n' : c;
+		}
+		out[used++] = c;
+	}
+	out[used] = '\0';
+}
+
+} // namespace
+
+size_t ESPWorker::writeMetrics(char *buffer, size_t capacity) const {
+	BufferSink out{buffer, capacity, 0};
+	streamMetrics(appendToBuffer, &out);
+	if (buffer && capacity > 0) {
+		buffer[out.length < capacity ? out.length : capacity - 1] = '\0';
+	}
+	return out.length;
+}
+
+void ESPWorker::streamMetrics(MetricsSink sink, void *context) const {
+	if (!sink) {
+		return;
+	}
+	MetricsWriter out(sink, context);
+	const WorkerCounters counters = getCounters();
+	const WorkerDiag diag = getDiag();
+
+	out.counter("espworker_jobs_spawned", "Jobs accepted by spawn.", counters.spawned);
+	out.counter("espworker_jobs_started", "Job attempts that started running.", counters.started);
+	out.counter("espworker_jobs_completed", "Jobs whose callback returned.", counters.completed);
+	out.counter("espworker_jobs_destroyed", "Jobs destroyed before returning.", counters.destroyed);
+	out.counter("espworker_jobs_deferred", "Jobs the memory governor queued.", counters.deferred);
+	out.counter(
+	    "espworker_external_fallbacks", "Jobs moved to PSRAM stacks.", counters.externalFallbacks
+	);
+	out.counter("espworker_isr_submitted", "Callbacks accepted from ISRs.", counters.isrSubmitted);
+	out.counter("espworker_isr_completed", "ISR callbacks that ran.", counters.isrCompleted);
+	out.counter("espworker_jobs_timed_out", "Jobs that outlived their timeout.", counters.timedOut);
+	out.counter("espworker_retries", "Retry attempts scheduled.", counters.retries);
+	out.counter("espworker_coalesced", "Spawns merged into an unfinished job.", counters.coalesced);
+	out.counter("espworker_jobs_inlined", "Jobs run on the spawning task.", counters.inlined);
+	out.counter("espworker_spin_waits", "Waits that polled before blocking.", counters.spinWaits);
+	out.counter("espworker_spin_joins", "Waits that ended while polling.", counters.spinJoins);
+
+	out.line("# TYPE espworker_errors counter");
+	out.line("# HELP espworker_errors Failures by WorkerError.");
+	for (size_t i = 1; i < kESPWorkerErrorCount; ++i) {
+		out.line(
+		    "espworker_errors_total{error=\"%s\"} %u",
+		    errorToString(static_cast<WorkerError>(i)),
+		    static_cast<unsigned>(counters.errors[i])
+		);
+	}
+
+	out.line("# TYPE espworker_busy_seconds counter");
+	out.line("# UNIT espworker_busy_seconds seconds");
+	out.line("# HELP espworker_busy_seconds Job runtime accumulated per core.");
+	for (size_t core = 0; core < kESPWorkerCoreCount; ++core) {
+		uint32_t ms = counters.busyTimeMs[core];
+		out.line(
+		    "espworker_busy_seconds_total{core=\"%u\"} %u.%03u",
+		    static_cast<unsigned>(core),
+		    static_cast<unsigned>(ms / 1000),
+		    static_cast<unsigned>(ms % 1000)
+		);
+	}
+
+	out.line("# TYPE espworker_cpu_seconds counter");
+	out.line("# UNIT espworker_cpu_seconds seconds");
+	out.line("# HELP espworker_cpu_seconds Job CPU time per core from run-time stats.");
+	for (size_t core = 0; core < kESPWorkerCoreCount; ++core) {
+		uint32_t us = counters.cpuTimeUs[core];
+		out.line(
+		    "espworker_cpu_seconds_total{core=\"%u\"} %u.%06u",
+		    static_cast<unsigned>(core),
+		    static_cast<unsigned>(us / 1000000),
+		    static_cast<unsigned>(us % 1000000)
+		);
+	}
+
+	out.line("# TYPE espworker_core_load_percent gauge");
+	out.line("# HELP espworker_core_load_percent Time each core spent outside its idle task.");
+	for (size_t core = 0; core < kESPWorkerCoreCount; ++core) {
+		out.line(
+		    "espworker_core_load_percent{core=\"%u\"} %u",
+		    static_cast<unsigned>(core),
+		    static_cast<unsigned>(diag.coreLoadPercent[core])
+		);
+	}
+
+	out.gauge("espworker_jobs", "Jobs tracked by the worker.", diag.totalJobs);
+	out.gauge("espworker_running_jobs", "Jobs running on a task.", diag.runningJobs);
+	out.gauge("espworker_queued_jobs", "Jobs waiting for a task or memory.", diag.waitingJobs);
+	out.gauge("espworker_deferred_jobs", "Jobs in the admission queue.", diag.deferredJobs);
+	out.gauge("espworker_psram_stack_jobs", "Jobs with PSRAM stacks.", diag.psramStackJobs);
+	out.gauge("espworker_pool_workers", "Elastic pool tasks alive.", diag.poolWorkers);
+	out.gauge("espworker_idle_workers", "Pool tasks waiting for a job.", diag.idleWorkers);
+
+	// Copy one name at a time so _mutex is never held while the sink runs.
+	WorkerNameStats stats;
+	char label[kESPWorkerNameCapacity * 2];
+	out.line("# TYPE espworker_job_timeouts counter");
+	out.line("# HELP espworker_job_timeouts Timeouts per job name.");
+	for (size_t i = 0; nameStatsAt(i, &stats); ++i) {
+		escapeLabel(stats.name.c_str(), label, sizeof(label));
+		out.line(
+		    "espworker_job_timeouts_total{name=\"%s\"} %u",
+		    label,
+		    static_cast<unsigned>(stats.timeouts)
+		);
+	}
+
+	out.line("# TYPE espworker_job_cpu_seconds counter");
+	out.line("# UNIT espworker_job_cpu_seconds seconds");
+	out.line("# HELP espworker_job_cpu_seconds CPU time of finished jobs per job name.");
+	for (size_t i = 0; nameStatsAt(i, &stats); ++i) {
+		escapeLabel(stats.name.c_str(), label, sizeof(label));
+		out.line(
+		    "espworker_job_cpu_seconds_total{name=\"%s\"} %llu.%06u",
+		    label,
+		    static_cast<unsigned long long>(stats.cpuTimeUsSum / 1000000),
+		    static_cast<unsigned>(stats.cpuTimeUsSum % 1000000)
+		);
+	}
+
+	out.line("# TYPE espworker_job_heap_retained_bytes gauge");
+	out.line("# UNIT espworker_job_heap_retained_bytes bytes");
+	out.line("# HELP espworker_job_heap_retained_bytes Free heap lost by jobs with trackHeap.");
+	for (size_t i = 0; nameStatsAt(i, &stats); ++i) {
+		escapeLabel(stats.name.c_str(), label, sizeof(label));
+		out.line(
+		    "espworker_job_heap_retained_bytes{name=\"%s\",heap=\"internal\"} %lld",
+		    label,
+		    static_cast<long long>(stats.internalHeapDeltaSum)
+		);
+		out.line(
+		    "espworker_job_heap_retained_bytes{name=\"%s\",heap=\"psram\"} %lld",
+		    label,
+		    static_cast<long long>(stats.psramHeapDeltaSum)
+		);
+	}
+
+	out.line("# TYPE espworker_job_heap_allocations counter");
+	out.line("# HELP espworker_job_heap_allocations Allocations counted by jobs with trackHeap.");
+	for (size_t i = 0; nameStatsAt(i, &stats); ++i) {
+		escapeLabel(stats.name.c_str(), label, sizeof(label));
+		out.line(
+		    "espworker_job_heap_allocations_total{name=\"%s\"} %u",
+		    label,
+		    static_cast<unsigned>(stats.heapAllocations)
+		);
+	}
+
+	out.line("# TYPE espworker_job_runtime_seconds histogram");
+	out.line("# UNIT espworker_job_runtime_seconds seconds");
+	out.line("# HELP espworker_job_runtime_seconds Runtime of finished jobs per job name.");
+	for (size_t i = 0; nameStatsAt(i, &stats); ++i) {
+		escapeLabel(stats.name.c_str(), label, sizeof(label));
+		uint32_t cumulative = 0;
+		for (size_t bucket = 0; bucket < kESPWorkerRuntimeBucketCount; ++bucket) {
+			uint32_t boundMs = kESPWorkerRuntimeBucketMs[bucket];
+			cumulative += stats.runtimeBuckets[bucket];
+			out.line(
+			    "espworker_job_runtime_seconds_bucket{name=\"%s\",le=\"%u.%03u\"} %u",
+			    label,
+			    static_cast<unsigned>(boundMs / 1000),
+			    static_cast<unsigned>(boundMs % 1000),
+			    static_cast<unsigned>(cumulative)
+			);
+		}
+		out.line(
+		    "espworker_job_runtime_seconds_bucket{name=\"%s\",le=\"+Inf\"} %u",
+		    label,
+		    static_cast<unsigned>(stats.finished)
+		);
+		out.line(
+		    "espworker_job_runtime_seconds_sum{name=\"%s\"} %llu.%03u",
+		    label,
+		    static_cast<unsigned long long>(stats.runtimeMsSum / 1000),
+		    static_cast<unsigned>(stats.runtimeMsSum % 1000)
+		);
+		out.line(
+		    "espworker_job_runtime_seconds_count{name=\"%s\"} %u",
+		    label,
+		    static_cast<unsigned>(stats.finished)
+		);
+	}
+
+	out.line("# EOF");
+}
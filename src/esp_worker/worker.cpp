@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <cstdio>
 #include <mutex>
 #include <new>
@@ -21,6 +22,20 @@ extern "C" {
 #define ESPWORKER_HAS_IDF_TASK_CAPS 0
 #endif
 
+#if __has_include("esp_timer.h")
+#include "esp_timer.h"
+#define ESPWORKER_HAS_ESP_TIMER 1
+#else
+#include <chrono>
+#define ESPWORKER_HAS_ESP_TIMER 0
+#endif
+
+#if defined(configSUPPORT_STATIC_ALLOCATION) && (configSUPPORT_STATIC_ALLOCATION == 1)
+#define ESPWORKER_CAN_USE_STATIC_TASKS 1
+#else
+#define ESPWORKER_CAN_USE_STATIC_TASKS 0
+#endif
+
 #if ESPWORKER_HAS_IDF_TASK_CAPS && defined(configSUPPORT_STATIC_ALLOCATION) &&                     \
     (configSUPPORT_STATIC_ALLOCATION == 1) && defined(MALLOC_CAP_SPIRAM)
 #define ESPWORKER_CAN_USE_EXTERNAL_STACKS 1
@@ -28,6 +43,19 @@ extern "C" {
 #define ESPWORKER_CAN_USE_EXTERNAL_STACKS 0
 #endif
 
+#if defined(configGENERATE_RUN_TIME_STATS) && (configGENERATE_RUN_TIME_STATS == 1)
+#define ESPWORKER_HAS_RUN_TIME_STATS 1
+#else
+#define ESPWORKER_HAS_RUN_TIME_STATS 0
+#endif
+
+#if ESPWORKER_HAS_RUN_TIME_STATS && defined(INCLUDE_xTaskGetIdleTaskHandle) &&                     \
+    (INCLUDE_xTaskGetIdleTaskHandle == 1)
+#define ESPWORKER_CAN_SAMPLE_CORE_LOAD 1
+#else
+#define ESPWORKER_CAN_SAMPLE_CORE_LOAD 0
+#endif
+
 namespace {
 constexpr size_t kMinStackSizeBytes = 1024;
 constexpr UBaseType_t kInternalCaps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
@@ -37,21 +65,228 @@ constexpr UBaseType_t kExternalStackCaps = MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT;
 constexpr UBaseType_t kExternalStackCaps = MALLOC_CAP_8BIT;
 #endif
 
+constexpr size_t kCountBlockBytes = 64;
+
+// Hands shared_ptr the count-block storage reserved inside one of the internal-RAM blocks
+// below. The block is freed once every count block carved from it has been deallocated.
+template <typename Block, typename T> struct InBlockAllocator {
+	using value_type = T;
+	template <typename U> struct rebind {
+		using other = InBlockAllocator<Block, U>;
+	};
+
+	Block *block;
+	unsigned char *storage;
+
+	InBlockAllocator(Block *owner, unsigned char *countStorage)
+	    : block(owner), storage(countStorage) {
+	}
+	template <typename U>
+	InBlockAllocator(const InBlockAllocator<Block, U> &other)
+	    : block(other.block), storage(other.storage) {
+	}
+
+	T *allocate(size_t count) {
+		static_assert(sizeof(T) <= kCountBlockBytes, "shared_ptr count block does not fit");
+		static_assert(alignof(T) <= alignof(std::max_align_t), "count block over-aligned");
+		(void)count;
+		block->liveCountBlocks.fetch_add(1, std::memory_order_relaxed);
+		return reinterpret_cast<T *>(storage);
+	}
+
+	void deallocate(T *, size_t) {
+		Block::release(block);
+	}
+
+	template <typename U> bool operator==(const InBlockAllocator<Block, U> &other) const {
+		return storage == other.storage;
+	}
+	template <typename U> bool operator!=(const InBlockAllocator<Block, U> &other) const {
+		return storage != other.storage;
+	}
+};
+
+template <typename Block> Block *createBlock() {
+	void *raw = heap_caps_malloc(sizeof(Block), kInternalCaps);
+	if (!raw) {
+		return nullptr;
+	}
+	return new (raw) Block;
+}
+
+// Fixed arena of equal blocks carved from one internal-RAM allocation. A bitmap serves as the
+// free list, so blocks are taken and returned from any task without a lock. Each block handed
+// out holds a reference, so the arena outlives a deinit() while handlers still point into it.
+struct BlockArena {
+	std::atomic<uint32_t> refs{1}; // the owning worker plus every block handed out
+	size_t blockBytes = 0;
+	size_t blocks = 0;
+	std::atomic<uint32_t> *used = nullptr; // one bit per block
+	unsigned char *storage = nullptr;
+
+	template <typename Block> static BlockArena *create(size_t count) {
+		constexpr size_t align = alignof(std::max_align_t);
+		const size_t words = (count + 31) / 32;
+		const size_t usedOffset = (sizeof(BlockArena) + align - 1) / align * align;
+		const size_t storageOffset =
+		    (usedOffset + words * sizeof(std::atomic<uint32_t>) + align - 1) / align * align;
+		auto *raw = static_cast<unsigned char *>(
+		    heap_caps_malloc(storageOffset + count * sizeof(Block), kInternalCaps)
+		);
+		if (!raw) {
+			return nullptr;
+		}
+		auto *arena = new (raw) BlockArena;
+		arena->blockBytes = sizeof(Block);
+		arena->blocks = count;
+		arena->used = reinterpret_cast<std::atomic<uint32_t> *>(raw + usedOffset);
+		for (size_t i = 0; i < words; ++i) {
+			new (&arena->used[i]) std::atomic<uint32_t>(0);
+		}
+		arena->storage = raw + storageOffset;
+		return arena;
+	}
+
+	void *take() {
+		for (size_t word = 0; word * 32 < blocks; ++word) {
+			const size_t bitsInWord = std::min<size_t>(32, blocks - word * 32);
+			const uint32_t mask = bitsInWord == 32 ? ~0u : (1u << bitsInWord) - 1;
+			uint32_t bits = used[word].load(std::memory_order_relaxed);
+			while (const uint32_t freeBits = ~bits & mask) {
+				const uint32_t bit = freeBits & (~freeBits + 1);
+				if (used[word].compare_exchange_weak(
+				        bits, bits | bit, std::memory_order_acquire, std::memory_order_relaxed
+				    )) {
+					refs.fetch_add(1, std::memory_order_relaxed);
+					return storage + (word * 32 + __builtin_ctz(bit)) * blockBytes;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	void put(void *block) {
+		const size_t index = (static_cast<unsigned char *>(block) - storage) / blockBytes;
+		used[index / 32].fetch_and(~(1u << (index % 32)), std::memory_order_release);
+		release();
+	}
+
+	void release() {
+		if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			this->~BlockArena();
+			heap_caps_free(this);
+		}
+	}
+};
+
+template <typename T> struct SharedBlock {
+	std::atomic<uint8_t> liveCountBlocks{0};
+	BlockArena *arena = nullptr;
+	alignas(T) unsigned char object[sizeof(T)];
+	alignas(std::max_align_t) unsigned char count[kCountBlockBytes];
+
+	static void release(SharedBlock *block) {
+		if (block->liveCountBlocks.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+			return;
+		}
+		BlockArena *arena = block->arena;
+		block->~SharedBlock();
+		if (arena) {
+			arena->put(block);
+		} else {
+			heap_caps_free(block);
+		}
+	}
+
+	template <typename... Args> std::shared_ptr<T> construct(Args &&...args) {
+		T *ptr = new (object) T(std::forward<Args>(args)...);
+		return std::shared_ptr<T>(
+		    ptr,
+		    [](T *constructed) { constructed->~T(); },
+		    InBlockAllocator<SharedBlock, T>(this, count)
+		);
+	}
+};
+
+// Single internal-RAM allocation holding the object and its shared_ptr count block.
 template <typename T, typename... Args> std::shared_ptr<T> makeInternalShared(Args &&...args) {
-	void *raw = heap_caps_malloc(sizeof(T), kInternalCaps);
+	auto *block = createBlock<SharedBlock<T>>();
+	if (!block) {
+		return {};
+	}
+	return block->construct(std::forward<Args>(args)...);
+}
+
+// Same, but from the static-mode arena when there is one. The arena's blocks are sized for job
+// state, so only objects that fit one are taken from it.
+template <typename T> std::shared_ptr<T> makeArenaShared(BlockArena *arena) {
+	if (!arena) {
+		return makeInternalShared<T>();
+	}
+	if (sizeof(SharedBlock<T>) > arena->blockBytes) {
+		return {};
+	}
+	void *raw = arena->take();
 	if (!raw) {
 		return {};
 	}
+	auto *block = new (raw) SharedBlock<T>;
+	block->arena = arena;
+	return block->construct();
+}
+
+// A job's control state, the shared handler returned to the caller, and that handler's
+// shared_ptr count block live in one internal-RAM allocation. The control state keeps its own
+// intrusive count and holds the block like a count block until its last reference goes.
+// In static allocation mode the blocks come from an arena reserved by init() instead.
+template <typename Impl, typename Handler> struct JobBlock {
+	std::atomic<uint8_t> liveCountBlocks{0};
+	BlockArena *arena = nullptr;
+	alignas(Impl) unsigned char impl[sizeof(Impl)];
+	alignas(Handler) unsigned char handler[sizeof(Handler)];
+	alignas(std::max_align_t) unsigned char handlerCount[kCountBlockBytes];
+
+	static JobBlock *create(BlockArena *arena) {
+		if (!arena) {
+			return createBlock<JobBlock>();
+		}
+		void *raw = arena->take();
+		if (!raw) {
+			return nullptr;
+		}
+		auto *block = new (raw) JobBlock;
+		block->arena = arena;
+		return block;
+	}
 
-	T *object = new (raw) T(std::forward<Args>(args)...);
-	return std::shared_ptr<T>(object, [](T *ptr) {
-		if (!ptr) {
+	static void release(JobBlock *block) {
+		if (block->liveCountBlocks.fetch_sub(1, std::memory_order_acq_rel) != 1) {
 			return;
 		}
-		ptr->~T();
-		heap_caps_free(ptr);
-	});
-}
+		BlockArena *arena = block->arena;
+		block->~JobBlock();
+		if (arena) {
+			arena->put(block);
+		} else {
+			heap_caps_free(block);
+		}
+	}
+
+	Impl *constructImpl() {
+		liveCountBlocks.fetch_add(1, std::memory_order_relaxed);
+		Impl *object = new (impl) Impl();
+		object->block = this;
+		return object;
+	}
+
+	std::shared_ptr<Handler> adoptHandler(Handler *object) {
+		return std::shared_ptr<Handler>(
+		    object,
+		    [](Handler *ptr) { ptr->~Handler(); },
+		    InBlockAllocator<JobBlock, Handler>(this, handlerCount)
+		);
+	}
+};
 
 bool hasExternalStackSupport() {
 #if ESPWORKER_CAN_USE_EXTERNAL_STACKS
@@ -106,6 +341,68 @@ void invokeWorkerCallback(const Callback &callback, Args... args) noexcept {
 	callback(args...);
 #endif
 }
+
+// Flags of the job running on this task, for ESPWorker::stopRequested()/reportFailure().
+thread_local const std::atomic<bool> *t_stopFlag = nullptr;
+thread_local std::atomic<bool> *t_failFlag = nullptr;
+thread_local std::atomic<uint32_t> *t_allocationCount = nullptr;
+
+bool deadlinePassed(TickType_t now, TickType_t deadline) {
+	return static_cast<int32_t>(now - deadline) >= 0;
+}
+
+// FNV-1a over the stored (possibly truncated) name.
+uint32_t hashName(const WorkerName &name) {
+	uint32_t hash = 2166136261u;
+	for (const char *c = name.c_str(); *c; ++c) {
+		hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+	}
+	return hash;
+}
+
+size_t psramFreeBytes() {
+#if defined(MALLOC_CAP_SPIRAM)
+	return heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+#else
+	return 0;
+#endif
+}
+
+// Run-time stats values are read as microseconds, which is what ESP-IDF's default esp_timer
+// run-time clock counts. All of them wrap at 2^32, so only differences are used.
+constexpr uint32_t kCoreLoadWindowUs = 1000000;
+
+uint32_t taskRunTime(TaskHandle_t task) {
+#if ESPWORKER_HAS_RUN_TIME_STATS
+	return static_cast<uint32_t>(ulTaskGetRunTimeCounter(task));
+#else
+	(void)task;
+	return 0;
+#endif
+}
+
+// Clock for bounded spins. The run-time stats clock is not used because it may only advance
+// at context switches.
+int64_t spinClockUs() {
+#if ESPWORKER_HAS_ESP_TIMER
+	return esp_timer_get_time();
+#else
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Added to a learned spin budget so jobs that barely run still cover their wake-up path.
+constexpr uint32_t kSpinSlackUs = 10;
+
+// The kernel credits a task's counter when it is switched out, so yield first to include the
+// slice the caller is running in.
+uint32_t currentTaskRunTime() {
+#if ESPWORKER_HAS_RUN_TIME_STATS
+	taskYIELD();
+#endif
+	return taskRunTime(xTaskGetCurrentTaskHandle());
+}
 } // namespace
 
 static_assert(
@@ -117,8 +414,103 @@ static_assert(
     "Default stack size must be aligned to StackType_t."
 );
 
-struct WorkerHandler::Impl {
+struct WorkerBatch::Impl {
+	std::atomic<size_t> remaining{0};
+	size_t size{0};
+
+	SemaphoreHandle_t done{nullptr};
+	StaticSemaphore_t doneBuffer{};
+
+	void finishOne() {
+		if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1 && done) {
+			xSemaphoreGive(done);
+		}
+	}
+
+	~Impl() {
+		if (done) {
+			vSemaphoreDelete(done);
+			done = nullptr;
+		}
+	}
+};
+
+struct WorkerStrand::Impl {
+	struct Node {
+		std::atomic<Node *> next{nullptr};
+		ESPWorker::TaskCallback callback{};
+	};
+
 	ESPWorker *owner{nullptr};
+	WorkerName name{};
+	std::atomic<size_t> pending{0};
+	std::atomic<bool> active{false}; // held by the one drain job allowed to pop
+
+	// Vyukov intrusive MPSC queue: producers swap head, the active drain job owns tail.
+	Node stub{};
+	std::atomic<Node *> head{&stub};
+	Node *tail{&stub};
+
+	static Node *createNode(ESPWorker::TaskCallback &&callback) {
+		void *raw = heap_caps_malloc(sizeof(Node), kInternalCaps);
+		if (!raw) {
+			return nullptr;
+		}
+		auto *node = new (raw) Node();
+		node->callback = std::move(callback);
+		return node;
+	}
+
+	static void destroyNode(Node *node) {
+		node->~Node();
+		heap_caps_free(node);
+	}
+
+	void push(Node *node) {
+		node->next.store(nullptr, std::memory_order_relaxed);
+		Node *previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	// Returns nullptr when empty or while a producer is between its two push steps; that
+	// producer re-checks the active flag afterwards, so the node is never stranded.
+	Node *pop() {
+		Node *first = tail;
+		Node *next = first->next.load(std::memory_order_acquire);
+		if (first == &stub) {
+			if (!next) {
+				return nullptr;
+			}
+			tail = next;
+			first = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (next) {
+			tail = next;
+			return first;
+		}
+		if (first != head.load(std::memory_order_acquire)) {
+			return nullptr;
+		}
+		push(&stub);
+		next = first->next.load(std::memory_order_acquire);
+		if (next) {
+			tail = next;
+			return first;
+		}
+		return nullptr;
+	}
+
+	~Impl() {
+		while (Node *node = pop()) {
+			destroyNode(node);
+		}
+	}
+};
+
+struct WorkerHandler::Impl {
+	// Cleared once the job completes: handlers may outlive the worker.
+	std::atomic<ESPWorker *> owner{nullptr};
 	ESPWorker::TaskCallback callback{};
 	WorkerConfig config{};
 
@@ -126,40 +518,161 @@ struct WorkerHandler::Impl {
 	TickType_t startTick{0};
 	TickType_t endTick{0};
 
-	SemaphoreHandle_t completion{nullptr};
-	StaticSemaphore_t completionBuffer{};
+	// Completion without a kernel object: each waiter links a node from its own stack and
+	// blocks on its task notification until the job finishes. Guarded by ESPWorker::_mutex.
+	struct Waiter {
+		TaskHandle_t task;
+		Waiter *next;
+		bool woken;
+	};
+	std::atomic<bool> completed{false}; // written under ESPWorker::_mutex, read without it
+	Waiter *waiters{nullptr};
+
+	void unlinkWaiter(Waiter &waiter) {
+		for (Waiter **link = &waiters; *link; link = &(*link)->next) {
+			if (*link == &waiter) {
+				*link = waiter.next;
+				return;
+			}
+		}
+	}
 
 	bool createdWithCaps{false};
+	int staticSlot{-1};
+	// Core of the running attempt; read without the lock by waiters deciding whether to spin.
+	std::atomic<BaseType_t> runCore{-1};
+	std::shared_ptr<WorkerBatch::Impl> batch{};
+	std::shared_ptr<WorkerMailboxBase> mailbox{};
+	WorkerAdmission admission{WorkerAdmission::Immediate};
+
+	bool pooled{false};
+	bool queued{false};           // in ESPWorker::_deferredControls, guarded by ESPWorker::_mutex
+	bool waitingForWorker{false}; // in ESPWorker::_poolQueue, guarded by ESPWorker::_mutex
+	bool tracked{false};          // counted in ESPWorker::_diagTotals, guarded by ESPWorker::_mutex
+	bool trackedRunning{false};   // counted as running in ESPWorker::_diagTotals
+	bool named{false};            // caller-provided name, aggregated in ESPWorker::_nameStats
+	bool supervised{false};       // deadline armed, guarded by ESPWorker::_mutex
+	TickType_t deadline{0};
+	TickType_t retryAt{0}; // guarded by ESPWorker::_mutex
+	Impl *tagPrev{nullptr}; // ESPWorker::_tags list links, guarded by ESPWorker::_mutex
+	Impl *tagNext{nullptr};
+	uint32_t nameHash{0};
+	bool indexed{false}; // in ESPWorker::_nameIndex, guarded by ESPWorker::_mutex
+	int handleSlot{-1};  // index in ESPWorker::_handleSlots, guarded by ESPWorker::_mutex
+	bool coalesceOpen{false}; // accepts WorkerConfig::coalesceKey merges, guarded by _mutex
+	bool ranInline{false};    // set before the job is published, then read-only
+	bool detached{false};     // spawnDetached(): no handler, completion or name index entry
+	std::weak_ptr<WorkerHandler> handler; // set before the job is published, then read-only
 
 	std::atomic<bool> running{false};
 	std::atomic<bool> destroyed{false};
 	std::atomic<bool> finalized{false};
+	std::atomic<bool> stopRequested{false};
+	std::atomic<bool> timedOut{false};
+	std::atomic<bool> failed{false};
+	std::atomic<bool> retryWaiting{false}; // backing off until retryAt; written under _mutex
+	std::atomic<uint8_t> attempts{0};
+	std::atomic<uint32_t> cpuTimeUs{0}; // summed over finished attempts
+	std::atomic<int32_t> internalHeapDelta{0};
+	std::atomic<int32_t> psramHeapDelta{0};
+	std::atomic<uint32_t> heapAllocations{0};
+	std::atomic<uint32_t> coalesced{0};
+
+	std::atomic<uint32_t> refs{0}; // WorkerRef count
+	void *block{nullptr};          // JobBlock holding this, or nullptr for a block of its own
+};
 
-	std::weak_ptr<Impl> self;
+void workerRefRetain(WorkerHandler::Impl *control) {
+	control->refs.fetch_add(1, std::memory_order_relaxed);
+}
 
-	~Impl();
-};
+void workerRefRelease(WorkerHandler::Impl *control) {
+	if (control->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+		return;
+	}
+	using Block = JobBlock<WorkerHandler::Impl, WorkerHandler>;
+	auto *block = static_cast<Block *>(control->block);
+	control->~Impl();
+	if (block) {
+		Block::release(block);
+	} else {
+		heap_caps_free(control);
+	}
+}
 
-WorkerHandler::WorkerHandler(std::shared_ptr<Impl> control) : _control(std::move(control)) {
+WorkerHandler::WorkerHandler(WorkerRef<Impl> control) : _control(std::move(control)) {
 }
 
-WorkerHandler::Impl::~Impl() {
-	if (completion) {
-		vSemaphoreDelete(completion);
-		completion = nullptr;
+ESPWorker::JobRef ESPWorker::createControl(std::shared_ptr<WorkerHandler> *handler) {
+	auto *arena = static_cast<BlockArena *>(_jobArena);
+	if (!handler && !arena) {
+		void *raw = heap_caps_malloc(sizeof(WorkerHandler::Impl), kInternalCaps);
+		return raw ? JobRef(new (raw) WorkerHandler::Impl()) : JobRef();
+	}
+	using Block = JobBlock<WorkerHandler::Impl, WorkerHandler>;
+	Block *block = Block::create(arena);
+	if (!block) {
+		return JobRef();
 	}
+	JobRef control(block->constructImpl());
+	if (handler) {
+		*handler = block->adoptHandler(new (block->handler) WorkerHandler(control));
+		control->handler = *handler;
+	}
+	return control;
 }
 
 ESPWorker::~ESPWorker() {
 	deinit();
+	for (auto &tag : _tags) {
+		if (tag.drained) {
+			vSemaphoreDelete(tag.drained);
+			tag.drained = nullptr;
+		}
+	}
 }
 
 void ESPWorker::deinit() {
-	std::vector<std::shared_ptr<WorkerHandler::Impl>> controls;
+	std::vector<JobRef> controls;
+	std::vector<TaskHandle_t> poolTasks;
+	TimerHandle_t supervisorTimer = nullptr;
+	std::vector<RateSlot> rateSlots; // pending debounced callbacks are dropped outside the lock
 	{
 		std::lock_guard<std::mutex> guard(_mutex);
 		_initialized.store(false, std::memory_order_release);
 		controls.swap(_activeControls);
+		rateSlots.swap(_rateSlots);
+		for (auto &control : controls) {
+			if (control) {
+				untrackControlLocked(*control);
+				control->queued = false;
+				control->waitingForWorker = false;
+			}
+		}
+		_deferredControls.clear();
+		_poolQueue.clear();
+		for (auto &slot : _poolSlots) {
+			if (slot.state != PoolSlot::State::Free && slot.task) {
+				poolTasks.push_back(slot.task);
+			}
+			setPoolSlotStateLocked(slot, PoolSlot::State::Free);
+			slot.task = nullptr;
+		}
+		releaseIsrRingLocked();
+		supervisorTimer = _supervisorTimer;
+		_supervisorTimer = nullptr;
+		_supervisorArmed = false;
+		_diagTotals.poolWorkers = 0;
+		publishDiagLocked();
+	}
+
+	for (TaskHandle_t task : poolTasks) {
+		if (task != xTaskGetCurrentTaskHandle()) {
+			vTaskDelete(task);
+		}
+	}
+	if (supervisorTimer) {
+		xTimerDelete(supervisorTimer, 0);
 	}
 
 	for (auto &control : controls) {
@@ -167,13 +680,23 @@ void ESPWorker::deinit() {
 			continue;
 		}
 
-		if (control->taskHandle && xTaskGetCurrentTaskHandle() != control->taskHandle) {
+		// Pooled jobs run on the pool tasks deleted above.
+		if (!control->pooled && control->taskHandle &&
+		    xTaskGetCurrentTaskHandle() != control->taskHandle) {
+			if (control->mailbox) {
+				control->mailbox->close();
+			}
 			deleteTaskHandle(control->taskHandle, control->createdWithCaps);
 		}
 		finalizeWorker(control, true);
 		control->owner = nullptr;
 	}
 
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		releaseStaticSlotsLocked();
+	}
+
 	{
 		std::lock_guard<std::mutex> guard(_callbackMutex);
 		_eventCallback = nullptr;
@@ -195,6 +718,26 @@ JobDiag WorkerHandler::getDiag() const {
 	diag.taskHandle = _control->taskHandle;
 	diag.running = _control->running.load(std::memory_order_acquire);
 	diag.destroyed = _control->destroyed.load(std::memory_order_acquire);
+	diag.admission = _control->admission;
+	diag.queued = diag.running && !diag.taskHandle && diag.admission == WorkerAdmission::Deferred;
+	diag.pooled = _control->pooled;
+	diag.timedOut = _control->timedOut.load(std::memory_order_acquire);
+	diag.stopRequested = _control->stopRequested.load(std::memory_order_acquire);
+	diag.failed = _control->failed.load(std::memory_order_acquire);
+	diag.attempts = _control->attempts.load(std::memory_order_relaxed);
+	diag.retryPending = _control->retryWaiting.load(std::memory_order_acquire);
+	diag.cpuTimeUs = _control->cpuTimeUs.load(std::memory_order_relaxed);
+	diag.internalHeapDelta = _control->internalHeapDelta.load(std::memory_order_relaxed);
+	diag.psramHeapDelta = _control->psramHeapDelta.load(std::memory_order_relaxed);
+	diag.heapAllocations = _control->heapAllocations.load(std::memory_order_relaxed);
+	diag.coalesced = _control->coalesced.load(std::memory_order_relaxed);
+	diag.ranInline = _control->ranInline;
+	if (_control->mailbox) {
+		diag.mailboxCapacity = _control->mailbox->capacity();
+		diag.mailboxDepth = _control->mailbox->depth();
+		diag.mailboxDelivered = _control->mailbox->delivered();
+		diag.mailboxDropped = _control->mailbox->dropped();
+	}
 
 	TickType_t endTicks = diag.running ? xTaskGetTickCount() : _control->endTick;
 	if (endTicks >= _control->startTick) {
@@ -209,187 +752,1553 @@ bool WorkerHandler::wait(TickType_t ticks) {
 	if (!_control) {
 		return false;
 	}
-	std::shared_ptr<Impl> control = _control;
-	if (!control->completion) {
-		return false;
-	}
-
-	if (!control->running.load(std::memory_order_acquire)) {
+	// A finished job is answered from its own state; its worker may be gone by now.
+	if (_control->completed.load(std::memory_order_acquire) ||
+	    !_control->running.load(std::memory_order_acquire)) {
 		return true;
 	}
-
-	if (xSemaphoreTake(control->completion, ticks) == pdTRUE) {
-		return true;
+	ESPWorker *owner = _control->owner.load(std::memory_order_acquire);
+	if (!owner) {
+		return _control->completed.load(std::memory_order_acquire);
 	}
-
-	return !control->running.load(std::memory_order_acquire);
+	return owner->waitCompletion(*_control, ticks);
 }
 
 bool WorkerHandler::destroy() {
 	if (!_control) {
 		return false;
 	}
-	std::shared_ptr<Impl> control = _control;
-	if (!control->owner) {
-		return false;
+	if (!_control->running.load(std::memory_order_acquire)) {
+		return true;
 	}
-	return control->owner->destroyWorker(control);
+	ESPWorker *owner = _control->owner.load(std::memory_order_acquire);
+	return owner && owner->destroyWorker(_control);
 }
 
-void ESPWorker::init(const Config &config) {
-	std::lock_guard<std::mutex> guard(_mutex);
-	_config = config;
-	_initialized.store(true, std::memory_order_release);
+void WorkerHandler::requestStop() {
+	if (_control) {
+		_control->stopRequested.store(true, std::memory_order_release);
+	}
 }
 
-WorkerResult ESPWorker::spawn(TaskCallback callback, const WorkerConfig &config) {
-	if (!_initialized) {
-		init(Config{});
-	}
-	WorkerConfig effective = config;
-	if (effective.stackSizeBytes == 0) {
-		effective.stackSizeBytes = _config.stackSizeBytes;
-	}
-	if (effective.priority == 0) {
-		effective.priority = _config.priority;
+bool WorkerHandler::stopRequested() const {
+	return _control && _control->stopRequested.load(std::memory_order_acquire);
+}
+
+WorkerBatch::WorkerBatch(std::shared_ptr<Impl> state) : _state(std::move(state)) {
+}
+
+bool WorkerBatch::valid() const {
+	return static_cast<bool>(_state);
+}
+
+size_t WorkerBatch::size() const {
+	return _state ? _state->size : 0;
+}
+
+size_t WorkerBatch::remaining() const {
+	return _state ? _state->remaining.load(std::memory_order_acquire) : 0;
+}
+
+bool WorkerBatch::waitAll(TickType_t ticks) {
+	if (!_state) {
+		return false;
 	}
-	if (effective.coreId == tskNO_AFFINITY) {
-		effective.coreId = _config.coreId;
+	std::shared_ptr<Impl> state = _state;
+	if (state->remaining.load(std::memory_order_acquire) == 0) {
+		return true;
 	}
-	if (effective.name.empty()) {
-		effective.name = makeName();
+	if (state->done && xSemaphoreTake(state->done, ticks) == pdTRUE) {
+		return true;
 	}
+	return state->remaining.load(std::memory_order_acquire) == 0;
+}
 
-	return spawnInternal(std::move(callback), std::move(effective));
+WorkerStrand::WorkerStrand(std::shared_ptr<Impl> state) : _state(std::move(state)) {
 }
 
-WorkerResult ESPWorker::spawnExt(TaskCallback callback, const WorkerConfig &config) {
-	WorkerConfig extConfig = config;
-	extConfig.useExternalStack = true;
-	return spawn(std::move(callback), extConfig);
+bool WorkerStrand::valid() const {
+	return static_cast<bool>(_state);
 }
 
-WorkerResult ESPWorker::spawnInternal(TaskCallback &&callback, WorkerConfig config) {
-	if (!callback) {
-		notifyError(WorkerError::InvalidConfig);
-		return {WorkerError::InvalidConfig, {}, "Callback must be callable"};
-	}
+const char *WorkerStrand::name() const {
+	return _state ? _state->name.c_str() : "";
+}
 
-	if (!isValidStackConfig(config.stackSizeBytes)) {
-		notifyError(WorkerError::InvalidConfig);
-		return {
-		    WorkerError::InvalidConfig,
-		    {},
-		    "stackSizeBytes must be >= 1024 and aligned to StackType_t"
-		};
+size_t WorkerStrand::pending() const {
+	return _state ? _state->pending.load(std::memory_order_acquire) : 0;
+}
+
+WorkerError WorkerStrand::post(std::function<void()> callback) {
+	if (!_state || !_state->owner) {
+		return WorkerError::NotInitialized;
 	}
+	return _state->owner->postToStrand(_state, std::move(callback));
+}
 
-	if (config.useExternalStack) {
-		if (!_config.enableExternalStacks) {
-			notifyError(WorkerError::ExternalStackUnsupported);
-			return {
-			    WorkerError::ExternalStackUnsupported,
-			    {},
-			    "External stacks are disabled in ESPWorker::Config"
-			};
+WorkerError ESPWorker::init(const Config &config) {
+	std::vector<PoolSlot *> prestart;
+	WorkerError staticError = WorkerError::None;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_config = config;
+		_config.minWorkers = std::min(_config.minWorkers, _config.maxWorkers);
+		staticError = setupStaticSlotsLocked();
+		_staticSetupError = staticError;
+		_poolSlots.clear();
+		_poolQueue.clear();
+		if (_config.elasticPool && !_config.staticAllocation) {
+			_poolSlots.resize(_config.maxWorkers);
+			_poolQueue.reserve(_config.poolQueueDepth);
 		}
-		if (!hasExternalStackSupport()) {
-			notifyError(WorkerError::ExternalStackUnsupported);
-			return {
-			    WorkerError::ExternalStackUnsupported,
-			    {},
-			    "External stack mode is not supported on this target"
-			};
+		releaseIsrRingLocked();
+		setupIsrRingLocked();
+		_activeControls.reserve(jobCapacityLocked());
+		_deferredControls.reserve(std::min(_config.admissionQueueDepth, _config.maxWorkers));
+		_nameStats.clear();
+		_nameStats.reserve(_config.nameStatsCapacity);
+		setupNameIndexLocked();
+		setupHandleSlotsLocked();
+		_rateSlots.clear();
+		_rateSlots.resize(_config.rateLimitKeys);
+		for (auto &tag : _tags) {
+			if (!tag.drained) {
+				tag.drained = xSemaphoreCreateBinaryStatic(&tag.drainedBuffer);
+			}
+			tag.spawned = 0;
+			tag.completed = 0;
+			tag.destroyed = 0;
+		}
+		_diagTotals.poolGrows = 0;
+		_diagTotals.poolShrinks = 0;
+		for (size_t i = 0; i < _config.minWorkers && i < _poolSlots.size(); ++i) {
+			_poolSlots[i].owner = this;
+			setPoolSlotStateLocked(_poolSlots[i], PoolSlot::State::Claimed);
+			_diagTotals.poolWorkers++;
+			prestart.push_back(&_poolSlots[i]);
 		}
+		publishDiagLocked();
+		resetCounters();
+		sampleCoreLoad(true);
+		_initialized.store(true, std::memory_order_release);
 	}
 
-	auto control = makeInternalShared<WorkerHandler::Impl>();
-	if (!control) {
-		notifyError(WorkerError::NoMemory);
-		return {WorkerError::NoMemory, {}, "Failed to allocate worker control in internal RAM"};
+	for (PoolSlot *slot : prestart) {
+		startPoolWorker(*slot);
 	}
-	control->owner = this;
-	control->callback = std::move(callback);
-	control->config = std::move(config);
+	if (staticError != WorkerError::None) {
+		notifyError(staticError);
+	}
+	return staticError;
+}
 
-	control->completion = xSemaphoreCreateBinaryStatic(&control->completionBuffer);
-	if (!control->completion) {
-		notifyError(WorkerError::NoMemory);
-		return {WorkerError::NoMemory, {}, "Failed to create completion semaphore"};
+WorkerResult ESPWorker::spawn(TaskCallback callback, const WorkerConfig &config) {
+	if (!_initialized) {
+		init(Config{});
 	}
+	return spawnInternal(std::move(callback), resolveConfig(config));
+}
 
-	control->self = control;
+WorkerResult ESPWorker::spawnUnique(
+    const char *name, TaskCallback callback, const WorkerConfig &config
+) {
+	if (!_initialized) {
+		init(Config{});
+	}
+	if (!_config.indexNames || !name || name[0] == '\0') {
+		notifyError(WorkerError::InvalidConfig);
+		return {WorkerError::InvalidConfig, {}, "spawnUnique needs Config::indexNames and a name"};
+	}
+	WorkerConfig named = resolveConfig(config);
+	named.name = name;
+	return spawnInternal(std::move(callback), named, nullptr, SpawnMode::Unique);
+}
 
-	bool limitReached = false;
+WorkerError ESPWorker::spawnDetached(TaskCallback callback, const WorkerConfig &config) {
+	if (!_initialized) {
+		init(Config{});
+	}
+	WorkerResult result =
+	    spawnInternal(std::move(callback), resolveConfig(config), nullptr, SpawnMode::Detached);
+	return result.error;
+}
+
+std::shared_ptr<WorkerHandler> ESPWorker::find(const char *name) {
+	if (!name) {
+		return nullptr;
+	}
+	const WorkerName key(name);
+	JobRef control;
 	{
 		std::lock_guard<std::mutex> guard(_mutex);
-		if (_activeControls.size() >= _config.maxWorkers) {
-			limitReached = true;
-		} else {
-			_activeControls.push_back(control);
+		WorkerHandler::Impl *found = findNamedLocked(key, hashName(key));
+		if (found) {
+			control = JobRef(found);
 		}
 	}
+	return control ? handlerFor(control) : nullptr;
+}
 
-	if (limitReached) {
-		notifyError(WorkerError::MaxWorkersReached);
-		return {WorkerError::MaxWorkersReached, {}, "Maximum workers reached"};
-	}
+WorkerResult ESPWorker::spawnDebounced(
+    uint32_t key, uint32_t windowMs, TaskCallback callback, const WorkerConfig &config
+) {
+	return spawnRateLimited(WorkerRateMode::Debounce, key, windowMs, std::move(callback), config);
+}
 
-	const size_t stackBytes = control->config.stackSizeBytes;
-	BaseType_t createResult = pdFAIL;
+WorkerResult ESPWorker::spawnThrottled(
+    uint32_t key, uint32_t minIntervalMs, TaskCallback callback, const WorkerConfig &config
+) {
+	return spawnRateLimited(
+	    WorkerRateMode::Throttle, key, minIntervalMs, std::move(callback), config
+	);
+}
+
+WorkerResult ESPWorker::spawnRateLimited(
+    WorkerRateMode mode,
+    uint32_t key,
+    uint32_t periodMs,
+    TaskCallback &&callback,
+    const WorkerConfig &config
+) {
+	if (!_initialized) {
+		init(Config{});
+	}
+	if (!callback) {
+		notifyError(WorkerError::InvalidConfig);
+		return {WorkerError::InvalidConfig, {}, "Callback must be callable"};
+	}
+	// Validated now so a debounced job cannot fail on the timer for a bad config.
+	WorkerConfig resolved = resolveConfig(config);
+	const char *message = nullptr;
+	WorkerError error = validateConfig(resolved, &message);
+	bool spawnNow = false;
+	TaskCallback superseded; // released outside the lock
+	const TickType_t now = xTaskGetTickCount();
+	TickType_t previousTick = 0;
+	if (error == WorkerError::None) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		RateSlot *slot = rateSlotLocked(key, mode, &error, &message);
+		if (!slot) {
+			// error and message are set
+		} else if (mode == WorkerRateMode::Throttle) {
+			slot->interval = pdMS_TO_TICKS(periodMs);
+			spawnNow =
+			    slot->stats.accepted == 0 || deadlinePassed(now, slot->tick + slot->interval);
+			if (spawnNow) {
+				previousTick = slot->tick;
+				slot->stats.accepted++;
+				slot->tick = now;
+			} else {
+				slot->stats.suppressed++;
+			}
+		} else if (!ensureSupervisorLocked()) {
+			error = WorkerError::NoMemory;
+			message = "Failed to create the supervisor timer";
+		} else {
+			if (slot->stats.pending) {
+				slot->stats.suppressed++;
+				superseded = std::move(slot->callback);
+			}
+			slot->interval = pdMS_TO_TICKS(periodMs);
+			slot->tick = now + slot->interval;
+			slot->callback = std::move(callback);
+			slot->config = resolved;
+			slot->stats.pending = true;
+			if (!_supervisorArmed || static_cast<int32_t>(slot->tick - _supervisorDeadline) < 0) {
+				armSupervisorLocked(slot->tick);
+			}
+		}
+	}
+	if (error != WorkerError::None) {
+		notifyError(error);
+		return {error, {}, message};
+	}
+	if (spawnNow) {
+		WorkerResult result = spawnInternal(std::move(callback), resolved);
+		if (result.error != WorkerError::None) {
+			std::lock_guard<std::mutex> guard(_mutex);
+			unacceptRateLocked(key, mode, now, previousTick);
+		}
+		return result;
+	}
+	WorkerResult result{};
+	result.suppressed = mode == WorkerRateMode::Throttle;
+	return result;
+}
+
+void ESPWorker::unacceptRateLocked(
+    uint32_t key, WorkerRateMode mode, TickType_t tick, TickType_t previousTick
+) {
+	for (auto &slot : _rateSlots) {
+		if (!slot.used || slot.stats.key != key || slot.stats.mode != mode) {
+			continue;
+		}
+		if (slot.stats.accepted > 0) {
+			slot.stats.accepted--;
+		}
+		// A later accept owns the window now.
+		if (mode == WorkerRateMode::Throttle && slot.tick == tick) {
+			slot.tick = previousTick;
+		}
+		return;
+	}
+}
+
+ESPWorker::RateSlot *ESPWorker::rateSlotLocked(
+    uint32_t key, WorkerRateMode mode, WorkerError *error, const char **message
+) {
+	const TickType_t now = xTaskGetTickCount();
+	RateSlot *unused = nullptr;
+	RateSlot *idle = nullptr;
+	for (auto &slot : _rateSlots) {
+		if (!slot.used) {
+			unused = unused ? unused : &slot;
+			continue;
+		}
+		if (slot.stats.key == key) {
+			if (slot.stats.mode != mode) {
+				*error = WorkerError::InvalidConfig;
+				*message = "Key is already rate limited in the other mode";
+				return nullptr;
+			}
+			return &slot;
+		}
+		// Nothing pending and, when throttled, the interval is over: forgetting it is harmless.
+		if (!idle && !slot.stats.pending &&
+		    (slot.stats.mode == WorkerRateMode::Debounce ||
+		     deadlinePassed(now, slot.tick + slot.interval))) {
+			idle = &slot;
+		}
+	}
+	RateSlot *slot = unused ? unused : idle;
+	if (!slot) {
+		*error = _rateSlots.empty() ? WorkerError::InvalidConfig : WorkerError::MaxWorkersReached;
+		*message = _rateSlots.empty() ? "Rate-limited spawns need Config::rateLimitKeys"
+		                              : "Every rate-limit key is busy";
+		return nullptr;
+	}
+	*slot = RateSlot{};
+	slot->used = true;
+	slot->stats.key = key;
+	slot->stats.mode = mode;
+	return slot;
+}
+
+size_t ESPWorker::getRateStats(WorkerRateStats *out, size_t capacity) const {
+	if (!out) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> guard(_mutex);
+	size_t count = 0;
+	for (const auto &slot : _rateSlots) {
+		if (count == capacity) {
+			break;
+		}
+		if (slot.used) {
+			out[count++] = slot.stats;
+		}
+	}
+	return count;
+}
+
+WorkerRateStats ESPWorker::getRateStats(uint32_t key) const {
+	std::lock_guard<std::mutex> guard(_mutex);
+	for (const auto &slot : _rateSlots) {
+		if (slot.used && slot.stats.key == key) {
+			return slot.stats;
+		}
+	}
+	WorkerRateStats empty{};
+	empty.key = key;
+	return empty;
+}
+
+WorkerResult ESPWorker::spawnExt(TaskCallback callback, const WorkerConfig &config) {
+	WorkerConfig extConfig = config;
+	extConfig.useExternalStack = true;
+	return spawn(std::move(callback), extConfig);
+}
+
+WorkerBatchResult ESPWorker::spawnBatch(
+    TaskCallback *callbacks, size_t count, const WorkerConfig &config, WorkerBatchPolicy policy
+) {
+	if (!_initialized) {
+		init(Config{});
+	}
+
+	WorkerBatchResult result{};
+	if (!callbacks || count == 0 || count > kESPWorkerMaxBatchSize) {
+		notifyError(WorkerError::InvalidConfig);
+		result.error = WorkerError::InvalidConfig;
+		result.message = "Batch size must be between 1 and kESPWorkerMaxBatchSize";
+		return result;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		if (!callbacks[i]) {
+			notifyError(WorkerError::InvalidConfig);
+			result.error = WorkerError::InvalidConfig;
+			result.message = "Callback must be callable";
+			return result;
+		}
+	}
+
+	WorkerConfig effective = resolveConfig(config);
+	result.error = validateConfig(effective, &result.message);
+	if (result.error != WorkerError::None) {
+		notifyError(result.error);
+		return result;
+	}
+
+	// Batches are checked for their combined stack size and never queued.
+	WorkerAdmission admission = WorkerAdmission::Immediate;
+	const bool pooled = poolEligible(effective);
+	if (!pooled) {
+		result.error = governAdmission(effective, count, &admission, &result.message);
+	}
+	if (result.error == WorkerError::None && admission == WorkerAdmission::Deferred) {
+		result.error = WorkerError::InsufficientMemory;
+		result.message = "Not enough internal RAM for the batch";
+	}
+	if (result.error != WorkerError::None) {
+		notifyError(result.error);
+		return result;
+	}
+
+	using Block = JobBlock<WorkerHandler::Impl, WorkerHandler>;
+	static_assert(
+	    sizeof(SharedBlock<WorkerBatch::Impl>) <= sizeof(Block),
+	    "batch state must fit a job arena block"
+	);
+	auto batch = makeArenaShared<WorkerBatch::Impl>(static_cast<BlockArena *>(_jobArena));
+	if (!batch) {
+		notifyError(WorkerError::NoMemory);
+		result.error = WorkerError::NoMemory;
+		result.message = "Failed to allocate batch state in internal RAM";
+		return result;
+	}
+	batch->done = xSemaphoreCreateBinaryStatic(&batch->doneBuffer);
+
+	JobRef controls[kESPWorkerMaxBatchSize];
+
+	for (size_t i = 0; i < count; ++i) {
+		// Batch jobs are joined through the batch, so they get no handler.
+		controls[i] = createControl(nullptr);
+		if (!controls[i]) {
+			notifyError(WorkerError::NoMemory);
+			result.error = WorkerError::NoMemory;
+			result.message = "Failed to allocate worker control in internal RAM";
+			return result;
+		}
+		controls[i]->owner = this;
+		controls[i]->config = effective;
+		controls[i]->admission = admission;
+		controls[i]->pooled = pooled;
+		if (effective.name.empty()) {
+			controls[i]->config.name = makeName();
+		} else {
+			controls[i]->named = true;
+		}
+		controls[i]->batch = batch;
+	}
+
+	// One lock reserves every slot the batch gets.
+	size_t admitted = 0;
+	bool noPoolWorker = false;
+	TaskHandle_t wakeTasks[kESPWorkerMaxBatchSize] = {};
+	PoolSlot *growSlots[kESPWorkerMaxBatchSize] = {};
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		const size_t capacity = pooled ? jobCapacityLocked() : _config.maxWorkers;
+		size_t available =
+		    capacity > _activeControls.size() ? capacity - _activeControls.size() : 0;
+		if (pooled) {
+			available = std::min(available, _config.poolQueueDepth - _poolQueue.size());
+		}
+		admitted = std::min(count, available);
+		if (policy == WorkerBatchPolicy::AllOrNothing && admitted < count) {
+			admitted = 0;
+		}
+		for (size_t i = 0; i < admitted; ++i) {
+			if (_config.staticAllocation && !acquireStaticSlotLocked(*controls[i])) {
+				break;
+			}
+			controls[i]->callback = std::move(callbacks[i]);
+			admitLocked(controls[i]);
+			batch->size++;
+		}
+		if (policy == WorkerBatchPolicy::AllOrNothing && batch->size < count) {
+			for (size_t i = 0; i < batch->size; ++i) {
+				callbacks[i] = std::move(controls[i]->callback);
+				releaseAdmissionLocked(*controls[i]);
+			}
+			batch->size = 0;
+		}
+		for (size_t i = 0; pooled && i < batch->size; ++i) {
+			dispatchPooledLocked(&wakeTasks[i], &growSlots[i]);
+		}
+		if (pooled && batch->size > 0 && _diagTotals.poolWorkers == 0) {
+			for (size_t i = 0; i < batch->size; ++i) {
+				callbacks[i] = std::move(controls[i]->callback);
+				releaseAdmissionLocked(*controls[i]);
+			}
+			batch->size = 0;
+			noPoolWorker = true;
+		}
+		batch->remaining.store(batch->size, std::memory_order_release);
+		publishDiagLocked();
+	}
+
+	if (noPoolWorker) {
+		notifyError(WorkerError::InsufficientMemory);
+		result.error = WorkerError::InsufficientMemory;
+		result.message = "Not enough internal RAM to start a pool task";
+		return result;
+	}
+	if (batch->size == 0) {
+		notifyError(WorkerError::MaxWorkersReached);
+		result.error = WorkerError::MaxWorkersReached;
+		result.message = "Maximum workers reached";
+		return result;
+	}
+
+	size_t created = 0;
+	if (pooled) {
+		bool growFailed = false;
+		for (size_t i = 0; i < batch->size; ++i) {
+			if (wakeTasks[i]) {
+				xTaskNotifyGive(wakeTasks[i]);
+			}
+			if (growSlots[i] && !startPoolWorker(*growSlots[i])) {
+				growFailed = true;
+				notifyError(WorkerError::TaskCreateFailed);
+			}
+		}
+		size_t stranded = 0;
+		if (growFailed) {
+			std::lock_guard<std::mutex> guard(_mutex);
+			for (size_t i = 0; _diagTotals.poolWorkers == 0 && i < batch->size; ++i) {
+				if (controls[i]->waitingForWorker) {
+					releaseAdmissionLocked(*controls[i]);
+					stranded++;
+				}
+			}
+			publishDiagLocked();
+		}
+		for (size_t i = 0; i < stranded; ++i) {
+			batch->finishOne();
+		}
+		if (stranded > 0) {
+			result.error = WorkerError::TaskCreateFailed;
+			result.message = "Failed to create pool task";
+		}
+		created = batch->size - stranded;
+	}
+
+	for (size_t i = 0; !pooled && i < batch->size; ++i) {
+		const WorkerError failure = createTask(*controls[i]);
+		if (failure == WorkerError::None) {
+			created++;
+			continue;
+		}
+		abandonControl(controls[i]);
+		batch->finishOne();
+		if (result.error == WorkerError::None) {
+			result.error = failure;
+			result.message = "Failed to create worker task";
+		}
+		notifyError(failure);
+	}
+
+	batch->size = created;
+	result.spawned = created;
+	result.batch = WorkerBatch(std::move(batch));
+	_counters.spawned.fetch_add(static_cast<uint32_t>(created), std::memory_order_relaxed);
+	if (admission == WorkerAdmission::ExternalFallback) {
+		_counters.externalFallbacks.fetch_add(
+		    static_cast<uint32_t>(created), std::memory_order_relaxed
+		);
+	}
+	notifyEvent(WorkerEvent::Created, created);
+	return result;
+}
+
+IRAM_ATTR WorkerIsrResult ESPWorker::submitFromISR(IsrCallback callback, void *arg) {
+	WorkerIsrResult result;
+	if (!_initialized.load(std::memory_order_acquire)) {
+		result.error = WorkerError::NotInitialized;
+	} else if (!callback || !_isrRing) {
+		result.error = WorkerError::InvalidConfig;
+	}
+
+	size_t pos = _isrEnqueuePos.load(std::memory_order_relaxed);
+	IsrJob *cell = nullptr;
+	while (result.error == WorkerError::None) {
+		cell = &_isrRing[pos & _isrMask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+		if (diff == 0) {
+			if (_isrEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			result.error = WorkerError::MaxWorkersReached; // ring full
+		} else {
+			pos = _isrEnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+	if (result.error != WorkerError::None) {
+		_counters.errors[static_cast<size_t>(result.error)].fetch_add(1, std::memory_order_relaxed);
+		return result;
+	}
+
+	cell->callback = callback;
+	cell->arg = arg;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	// Pairs with the fence after a pool task parks: either it sees this cell or we see it parked.
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	_counters.isrSubmitted.fetch_add(1, std::memory_order_relaxed);
+
+	// Wake at most one parked pool task; taking its handle keeps a second ISR from waking the
+	// same task and the task from exiting underneath the notification.
+	for (size_t i = 0; i < _poolSlots.size(); ++i) {
+		TaskHandle_t task = _isrWaiters[i].exchange(nullptr, std::memory_order_acq_rel);
+		if (task) {
+			vTaskNotifyGiveFromISR(task, &result.yieldRequired);
+			break;
+		}
+	}
+	return result;
+}
+
+WorkerStrand ESPWorker::strand(const char *name) {
+	if (_config.staticAllocation) {
+		// Every post would allocate a queue node.
+		notifyError(WorkerError::InvalidConfig);
+		return WorkerStrand();
+	}
+	auto state = makeInternalShared<WorkerStrand::Impl>();
+	if (!state) {
+		notifyError(WorkerError::NoMemory);
+		return WorkerStrand();
+	}
+	state->owner = this;
+	state->name = (name && name[0] != '\0') ? WorkerName(name) : makeName();
+	return WorkerStrand(std::move(state));
+}
+
+WorkerError ESPWorker::postToStrand(
+    const std::shared_ptr<WorkerStrand::Impl> &strand, TaskCallback &&callback
+) {
+	if (!callback) {
+		notifyError(WorkerError::InvalidConfig);
+		return WorkerError::InvalidConfig;
+	}
+	WorkerStrand::Impl::Node *node = WorkerStrand::Impl::createNode(std::move(callback));
+	if (!node) {
+		notifyError(WorkerError::NoMemory);
+		return WorkerError::NoMemory;
+	}
+	strand->push(node);
+	strand->pending.fetch_add(1, std::memory_order_acq_rel);
+
+	// Whoever flips the strand to active schedules the drain job; everyone else just queues.
+	if (strand->active.exchange(true)) {
+		return WorkerError::None;
+	}
+	WorkerConfig config{};
+	config.name = strand->name;
+	WorkerResult result = spawn([strand]() { strand->owner->drainStrand(*strand); }, config);
+	if (!result) {
+		// onError() has the spawn failure. The job is queued and cannot be taken back out of the
+		// MPSC queue, so it is reported as accepted and runs with the next drain a post starts.
+		strand->active.store(false);
+	}
+	return WorkerError::None;
+}
+
+void ESPWorker::drainStrand(WorkerStrand::Impl &strand) {
+	while (true) {
+		size_t ran = 0;
+		while (WorkerStrand::Impl::Node *node = strand.pop()) {
+			TaskCallback callback = std::move(node->callback);
+			WorkerStrand::Impl::destroyNode(node);
+			invokeWorkerCallback(callback);
+			strand.pending.fetch_sub(1, std::memory_order_acq_rel);
+			ran++;
+		}
+
+		strand.active.store(false);
+		// A producer that pushed while we were active saw the flag set and left its job to us.
+		// If nothing was poppable, a producer is mid-push and will reschedule by itself.
+		if (ran == 0 || strand.pending.load(std::memory_order_acquire) == 0 ||
+		    strand.active.exchange(true)) {
+			return;
+		}
+	}
+}
+
+WorkerConfig ESPWorker::resolveConfig(const WorkerConfig &config) {
+	WorkerConfig effective = config;
+	if (effective.stackSizeBytes == 0) {
+		effective.stackSizeBytes = _config.stackSizeBytes;
+	}
+	if (effective.priority == 0) {
+		effective.priority = _config.priority;
+	}
+	if (effective.coreId == tskNO_AFFINITY) {
+		effective.coreId = _config.coreId;
+	}
+	return effective;
+}
+
+WorkerError ESPWorker::validateConfig(const WorkerConfig &config, const char **message) const {
+	if (!isValidStackConfig(config.stackSizeBytes)) {
+		*message = "stackSizeBytes must be >= 1024 and aligned to StackType_t";
+		return WorkerError::InvalidConfig;
+	}
+
+	if (config.tag >= kESPWorkerTagCount) {
+		*message = "tag must be below kESPWorkerTagCount";
+		return WorkerError::InvalidConfig;
+	}
+
+	if (config.useExternalStack) {
+		if (!_config.enableExternalStacks) {
+			*message = "External stacks are disabled in ESPWorker::Config";
+			return WorkerError::ExternalStackUnsupported;
+		}
+		if (!hasExternalStackSupport()) {
+			*message = "External stack mode is not supported on this target";
+			return WorkerError::ExternalStackUnsupported;
+		}
+	}
+
+	if (_config.staticAllocation) {
+#if ESPWORKER_CAN_USE_STATIC_TASKS
+		if (_staticSetupError != WorkerError::None) {
+			*message = "init() could not reserve the static task slots";
+			return _staticSetupError;
+		}
+		if (config.useExternalStack) {
+			*message = "External stacks are unavailable in static allocation mode";
+			return WorkerError::ExternalStackUnsupported;
+		}
+		if (config.stackSizeBytes > _staticStackBytes) {
+			*message = "stackSizeBytes exceeds the static slot stack size";
+			return WorkerError::InvalidConfig;
+		}
+#else
+		*message = "Static allocation mode requires configSUPPORT_STATIC_ALLOCATION";
+		return WorkerError::InvalidConfig;
+#endif
+	}
+
+	return WorkerError::None;
+}
+
+WorkerResult ESPWorker::spawnActorJob(
+    TaskCallback &&callback, const WorkerConfig &config, std::shared_ptr<WorkerMailboxBase> mailbox
+) {
+	if (!_initialized) {
+		init(Config{});
+	}
+	return spawnInternal(std::move(callback), resolveConfig(config), std::move(mailbox));
+}
+
+WorkerResult ESPWorker::spawnInternal(
+    TaskCallback &&callback,
+    const WorkerConfig &requested,
+    std::shared_ptr<WorkerMailboxBase> mailbox,
+    SpawnMode mode
+) {
+	if (!callback) {
+		notifyError(WorkerError::InvalidConfig);
+		return {WorkerError::InvalidConfig, {}, "Callback must be callable"};
+	}
+
+	const char *message = nullptr;
+	WorkerError error = validateConfig(requested, &message);
+	if (error != WorkerError::None) {
+		notifyError(error);
+		return {error, {}, message};
+	}
+
+	if (requested.coalesceKey != 0) {
+		JobRef existing;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			existing = coalesceLocked(requested, callback);
+		}
+		if (existing) {
+			return existingResult(existing);
+		}
+	}
+
+	// Pooled jobs reuse existing stacks; the governor only gates growing the pool.
+	WorkerConfig config = requested;
+	WorkerAdmission admission = WorkerAdmission::Immediate;
+	// Inline jobs borrow the caller's stack, so neither applies to them.
+	const bool runInline = !mailbox && mode != SpawnMode::Timer && inlineEligible(config);
+	// Actors block on their mailbox for their whole life, so they never take a pool task.
+	const bool pooled = !mailbox && !runInline && poolEligible(config);
+	const bool retryEnabled = config.retry.maxAttempts > 1;
+	bool noHeadroom = false;
+	if (!pooled && !runInline) {
+		error = governAdmission(config, 1, &admission, &message);
+		// With a retry policy the job is admitted and backs off until memory recovers.
+		noHeadroom = error == WorkerError::InsufficientMemory && retryEnabled;
+		if (error != WorkerError::None && !noHeadroom) {
+			notifyError(error);
+			return {error, {}, message};
+		}
+	}
+
+	const bool detached = mode == SpawnMode::Detached;
+	// Adopted before the job is published so find() and spawnUnique() can hand it out. A
+	// detached job never gets one, so its block has no room for it.
+	std::shared_ptr<WorkerHandler> handler;
+	JobRef control = createControl(detached ? nullptr : &handler);
+	if (!control) {
+		notifyError(WorkerError::NoMemory);
+		return {WorkerError::NoMemory, {}, "Failed to allocate worker control in internal RAM"};
+	}
+	control->owner = this;
+	control->callback = std::move(callback);
+	control->config = config;
+	if (config.name.empty()) {
+		control->config.name = makeName();
+	} else {
+		control->named = true;
+		control->nameHash = hashName(control->config.name);
+	}
+	control->admission = admission;
+	control->pooled = pooled;
+	control->ranInline = runInline;
+	control->detached = detached;
+	control->mailbox = std::move(mailbox);
+
+	JobRef existing;
+	WorkerSlotHandle slot{};
+	bool limitReached = false;
+	bool queueFull = false;
+	bool noPoolWorker = false;
+	bool retryScheduled = false;
+	TaskHandle_t wakeTask = nullptr;
+	PoolSlot *growSlot = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (mode == SpawnMode::Unique) {
+			WorkerHandler::Impl *running = findNamedLocked(control->config.name, control->nameHash);
+			existing = JobRef(running);
+		} else if (config.coalesceKey != 0) {
+			// Checked again here: another spawn with the key may have been admitted meanwhile.
+			existing = coalesceLocked(config, control->callback);
+		}
+		// Keep the admission queue FIFO: nothing overtakes a job that is already waiting.
+		if (!pooled && !runInline && !noHeadroom &&
+		    control->admission == WorkerAdmission::Immediate && !_deferredControls.empty()) {
+			control->admission = WorkerAdmission::Deferred;
+		}
+		const size_t capacity = pooled ? jobCapacityLocked() : _config.maxWorkers;
+		if (existing) {
+			// spawnUnique() or coalescing hands out the unfinished job instead.
+		} else if (_activeControls.size() >= capacity ||
+		           (pooled && _poolQueue.size() >= _config.poolQueueDepth)) {
+			limitReached = true;
+		} else if (control->admission == WorkerAdmission::Deferred &&
+		           _deferredControls.size() >= _config.admissionQueueDepth) {
+			queueFull = true;
+		} else if (_config.staticAllocation && !runInline && !acquireStaticSlotLocked(*control)) {
+			// Taken last so a rejected spawn never holds a slot. A job waiting to retry keeps
+			// its place in _activeControls without one, so slots can run out first.
+			limitReached = true;
+		} else {
+			admitLocked(control);
+			slot = slotHandleLocked(*control);
+			if (pooled) {
+				dispatchPooledLocked(&wakeTask, &growSlot);
+				if (!wakeTask && !growSlot && _diagTotals.poolWorkers == 0) {
+					noPoolWorker = true;
+					if (retryEnabled && scheduleRetryLocked(*control)) {
+						retryScheduled = true;
+					} else {
+						releaseAdmissionLocked(*control);
+					}
+				}
+			}
+			publishDiagLocked();
+		}
+	}
+
+	if (existing) {
+		return existingResult(existing);
+	}
+	if (limitReached) {
+		notifyError(WorkerError::MaxWorkersReached);
+		return {WorkerError::MaxWorkersReached, {}, "Maximum workers reached"};
+	}
+	if (queueFull) {
+		notifyError(WorkerError::InsufficientMemory);
+		return {WorkerError::InsufficientMemory, {}, "Admission queue is full"};
+	}
+	if (noPoolWorker) {
+		notifyError(WorkerError::InsufficientMemory);
+		if (!retryScheduled) {
+			return {
+			    WorkerError::InsufficientMemory, {}, "Not enough internal RAM to start a pool task"
+			};
+		}
+	}
+
+	const WorkerAdmission admitted = control->admission;
+	if (pooled) {
+		if (wakeTask) {
+			xTaskNotifyGive(wakeTask);
+		}
+		if (growSlot && !startPoolWorker(*growSlot)) {
+			bool stranded = false;
+			{
+				std::lock_guard<std::mutex> guard(_mutex);
+				if (_diagTotals.poolWorkers == 0 && control->waitingForWorker &&
+				    !(retryEnabled && scheduleRetryLocked(*control))) {
+					releaseAdmissionLocked(*control);
+					stranded = true;
+				}
+				publishDiagLocked();
+			}
+			notifyError(WorkerError::TaskCreateFailed);
+			if (stranded) {
+				return {WorkerError::TaskCreateFailed, {}, "Failed to create pool task"};
+			}
+		}
+	} else if (!runInline && admitted != WorkerAdmission::Deferred) {
+		const WorkerError failure =
+		    noHeadroom ? WorkerError::InsufficientMemory : createTask(*control);
+		if (failure != WorkerError::None && !retryEnabled) {
+			abandonControl(control);
+			notifyError(failure);
+			return {
+			    failure,
+			    {},
+			    failure == WorkerError::NoMemory ? "Not enough memory for the worker task"
+			                                     : "Failed to create worker task"
+			};
+		}
+		if (failure != WorkerError::None) {
+			// The handler is returned either way; wait() reports the outcome of the last attempt.
+			retryLaunch(control, failure);
+		}
+	}
+
+	_counters.spawned.fetch_add(1, std::memory_order_relaxed);
+	if (admitted == WorkerAdmission::Deferred) {
+		_counters.deferred.fetch_add(1, std::memory_order_relaxed);
+	} else if (admitted == WorkerAdmission::ExternalFallback) {
+		_counters.externalFallbacks.fetch_add(1, std::memory_order_relaxed);
+	}
+	notifyEvent(WorkerEvent::Created);
+	if (runInline) {
+		// Same start, events and completion as a worker task, so wait() returns immediately.
+		_counters.inlined.fetch_add(1, std::memory_order_relaxed);
+		markStarted(*control);
+		runTask(control);
+	}
+	WorkerResult result{WorkerError::None, std::move(handler), nullptr};
+	if (!detached) {
+		result.handle = WorkerHandler(std::move(control));
+		result.slot = slot;
+	}
+	return result;
+}
+
+bool ESPWorker::inlineEligible(const WorkerConfig &config) const {
+#if ESPWORKER_HAS_RUN_TIME_STATS
+	if (config.inlineIfCheaperThanUs == 0 || config.name.empty()) {
+		return false;
+	}
+	// Destroying a job that runs on the caller's stack would free its state under it.
+	if (config.timeoutMs > 0 && config.timeoutPolicy == WorkerTimeoutPolicy::Destroy) {
+		return false;
+	}
+	// Unknown names run on a task first so their cost gets measured.
+	std::lock_guard<std::mutex> guard(_mutex);
+	const WorkerNameStats *stats = findNameStatsLocked(config.name);
+	return stats && stats->completed > 0 && stats->cpuTimeUsEwma < config.inlineIfCheaperThanUs;
+#else
+	(void)config;
+	return false;
+#endif
+}
+
+void ESPWorker::admitLocked(const JobRef &control) {
+	// Mark running before the task exists so a task that finishes immediately cannot have its
+	// completion overwritten.
+	control->running.store(true, std::memory_order_release);
+	control->startTick = xTaskGetTickCount();
+	control->attempts = 1;
+	control->coalesceOpen = control->config.coalesceKey != 0 && !control->detached;
+	_activeControls.push_back(control);
+	if (control->admission == WorkerAdmission::Deferred) {
+		control->queued = true;
+		_deferredControls.push_back(control);
+	} else if (control->pooled) {
+		control->waitingForWorker = true;
+		_poolQueue.push_back(control);
+	}
+	trackControlLocked(*control);
+}
+
+void ESPWorker::releaseAdmissionLocked(WorkerHandler::Impl &control) {
+	control.running.store(false, std::memory_order_release);
+	control.taskHandle = nullptr;
+	if (control.staticSlot >= 0) {
+		_staticSlots[control.staticSlot].state = StaticSlot::State::Free;
+		control.staticSlot = -1;
+	}
+	eraseControlLocked(&control);
+}
+
+void ESPWorker::abandonControl(const JobRef &control) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	releaseAdmissionLocked(*control);
+	publishDiagLocked();
+}
+
+size_t ESPWorker::jobCapacityLocked() const {
+	return _config.maxWorkers + (_poolSlots.empty() ? 0 : _config.poolQueueDepth);
+}
+
+bool ESPWorker::poolEligible(const WorkerConfig &config) const {
+	if (_poolSlots.empty() || config.useExternalStack) {
+		return false;
+	}
+	return config.stackSizeBytes <= _config.stackSizeBytes &&
+	       (config.coreId == _config.coreId || config.coreId == tskNO_AFFINITY);
+}
+
+bool ESPWorker::governorEnabled() const {
+	return !_config.staticAllocation &&
+	       (_config.minFreeInternalBytes > 0 || _config.minLargestInternalBlock > 0 ||
+	        _config.psramReserveBytes > 0);
+}
+
+bool ESPWorker::hasStackHeadroom(size_t stackBytes, bool external, size_t releasedBytes) const {
+	if (external) {
+		size_t freeBytes = heap_caps_get_free_size(kExternalStackCaps) + releasedBytes;
+		return freeBytes >= stackBytes + _config.psramReserveBytes;
+	}
+	if (_config.minFreeInternalBytes == 0 && _config.minLargestInternalBlock == 0) {
+		return true;
+	}
+	// releasedBytes is the stack of a task that is finishing but not freed yet; it returns to
+	// the heap as one block once the idle task reclaims it.
+	size_t freeBytes = heap_caps_get_free_size(kInternalCaps) + releasedBytes;
+	size_t largest = std::max(heap_caps_get_largest_free_block(kInternalCaps), releasedBytes);
+	return freeBytes >= stackBytes + _config.minFreeInternalBytes &&
+	       largest >= std::max(stackBytes, _config.minLargestInternalBlock);
+}
+
+WorkerError ESPWorker::governAdmission(
+    WorkerConfig &config, size_t jobs, WorkerAdmission *admission, const char **message
+) const {
+	*admission = WorkerAdmission::Immediate;
+	if (!governorEnabled()) {
+		return WorkerError::None;
+	}
+
+	const size_t stackBytes = config.stackSizeBytes * jobs;
+	if (hasStackHeadroom(stackBytes, config.useExternalStack)) {
+		return WorkerError::None;
+	}
+
+	switch (_config.memoryPolicy) {
+	case WorkerMemoryPolicy::ExternalStack:
+		if (!config.useExternalStack && _config.enableExternalStacks && hasExternalStackSupport() &&
+		    hasStackHeadroom(stackBytes, true)) {
+			config.useExternalStack = true;
+			*admission = WorkerAdmission::ExternalFallback;
+			return WorkerError::None;
+		}
+		break;
+	case WorkerMemoryPolicy::Queue:
+		*admission = WorkerAdmission::Deferred;
+		return WorkerError::None;
+	case WorkerMemoryPolicy::Reject:
+	default:
+		break;
+	}
+
+	*message = config.useExternalStack ? "Spawning would break the PSRAM reserve"
+	                                   : "Not enough internal RAM to admit the worker";
+	return WorkerError::InsufficientMemory;
+}
+
+void ESPWorker::admitDeferred(size_t releasedBytes, bool releasedExternal) {
+	while (_initialized.load(std::memory_order_acquire)) {
+		JobRef control;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			if (_deferredControls.empty()) {
+				return;
+			}
+			const WorkerConfig &config = _deferredControls.front()->config;
+			size_t credit = releasedExternal == config.useExternalStack ? releasedBytes : 0;
+			if (!hasStackHeadroom(config.stackSizeBytes, config.useExternalStack, credit)) {
+				return;
+			}
+			control = std::move(_deferredControls.front());
+			_deferredControls.erase(_deferredControls.begin());
+			promoteDeferredLocked(*control);
+			publishDiagLocked();
+		}
+		// The credit covered only the head of the queue.
+		releasedBytes = 0;
+
+		const WorkerError failure = createTask(*control);
+		if (failure != WorkerError::None) {
+			retryLaunch(control, failure);
+		}
+	}
+}
+
+WorkerError ESPWorker::createTask(WorkerHandler::Impl &control) {
+	const size_t stackBytes = control.config.stackSizeBytes;
+	BaseType_t createResult = pdFAIL;
+	control.createdWithCaps = false;
+
+	if (control.staticSlot >= 0) {
+#if ESPWORKER_CAN_USE_STATIC_TASKS
+		StaticSlot &slot = _staticSlots[control.staticSlot];
+		// A static task's handle is its TCB, so publish it before the task can run.
+		control.taskHandle = reinterpret_cast<TaskHandle_t>(slot.tcb);
+		TaskHandle_t created = xTaskCreateStaticPinnedToCore(
+		    taskTrampoline,
+		    control.config.name.c_str(),
+		    static_cast<uint32_t>(stackBytes),
+		    &control,
+		    control.config.priority,
+		    slot.stack,
+		    slot.tcb,
+		    control.config.coreId
+		);
+		createResult = created ? pdPASS : pdFAIL;
+#endif
+	} else if (control.config.useExternalStack) {
+#if ESPWORKER_CAN_USE_EXTERNAL_STACKS
+		createResult = xTaskCreatePinnedToCoreWithCaps(
+		    taskTrampoline,
+		    control.config.name.c_str(),
+		    static_cast<configSTACK_DEPTH_TYPE>(stackBytes),
+		    &control,
+		    control.config.priority,
+		    &control.taskHandle,
+		    control.config.coreId,
+		    kExternalStackCaps
+		);
+		control.createdWithCaps = (createResult == pdPASS);
+#endif
+	} else {
+		createResult = xTaskCreatePinnedToCore(
+		    taskTrampoline,
+		    control.config.name.c_str(),
+		    static_cast<uint32_t>(stackBytes),
+		    &control,
+		    control.config.priority,
+		    &control.taskHandle,
+		    control.config.coreId
+		);
+	}
+	if (createResult == pdPASS) {
+		return WorkerError::None;
+	}
+	return createResult == errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY ? WorkerError::NoMemory
+	                                                             : WorkerError::TaskCreateFailed;
+}
+
+WorkerError ESPWorker::setupStaticSlotsLocked() {
+	if (!_config.staticAllocation || !_staticSlots.empty()) {
+		return WorkerError::None;
+	}
+#if ESPWORKER_CAN_USE_STATIC_TASKS
+	const size_t count = _config.maxWorkers;
+	const size_t stackBytes = _config.stackSizeBytes;
+	if (count == 0 || !isValidStackConfig(stackBytes)) {
+		return WorkerError::InvalidConfig;
+	}
+
+	StaticTask_t *tasks = _config.staticTaskBuffers;
+	if (!tasks) {
+		tasks = static_cast<StaticTask_t *>(
+		    heap_caps_malloc(count * sizeof(StaticTask_t), kInternalCaps)
+		);
+		_ownedStaticTasks = tasks;
+	}
+	StackType_t *stacks = _config.staticStackBuffer;
+	if (!stacks) {
+		stacks = static_cast<StackType_t *>(heap_caps_malloc(count * stackBytes, kInternalCaps));
+		_ownedStaticStacks = stacks;
+	}
+	if (!tasks || !stacks) {
+		releaseStaticSlotsLocked();
+		return WorkerError::NoMemory;
+	}
+
+	// Job state for every spawn comes from here too. Twice the slots leave room for handlers
+	// kept after their jobs finish; each one holds its block until it is dropped.
+	_jobArena = BlockArena::create<JobBlock<WorkerHandler::Impl, WorkerHandler>>(2 * count);
+	if (!_jobArena) {
+		releaseStaticSlotsLocked();
+		return WorkerError::NoMemory;
+	}
+
+	_staticSlots.resize(count);
+	for (size_t i = 0; i < count; ++i) {
+		_staticSlots[i].tcb = &tasks[i];
+		_staticSlots[i].stack = stacks + (i * stackBytes) / sizeof(StackType_t);
+		_staticSlots[i].state = StaticSlot::State::Free;
+	}
+	_staticStackBytes = stackBytes;
+	return WorkerError::None;
+#else
+	return WorkerError::InvalidConfig; // reported per spawn by validateConfig()
+#endif
+}
+
+void ESPWorker::releaseStaticSlotsLocked() {
+#if ESPWORKER_CAN_USE_STATIC_TASKS
+	for (auto &slot : _staticSlots) {
+		if (slot.state != StaticSlot::State::Free) {
+			TaskHandle_t task = reinterpret_cast<TaskHandle_t>(slot.tcb);
+			if (task != xTaskGetCurrentTaskHandle() && eTaskGetState(task) != eDeleted) {
+				vTaskDelete(task);
+			}
+		}
+	}
+#endif
+	_staticSlots.clear();
+	_staticStackBytes = 0;
+	if (_ownedStaticTasks) {
+		heap_caps_free(_ownedStaticTasks);
+		_ownedStaticTasks = nullptr;
+	}
+	if (_ownedStaticStacks) {
+		heap_caps_free(_ownedStaticStacks);
+		_ownedStaticStacks = nullptr;
+	}
+	if (_jobArena) {
+		static_cast<BlockArena *>(_jobArena)->release();
+		_jobArena = nullptr;
+	}
+}
 
-	if (control->config.useExternalStack) {
-#if ESPWORKER_CAN_USE_EXTERNAL_STACKS
-		createResult = xTaskCreatePinnedToCoreWithCaps(
-		    taskTrampoline,
-		    control->config.name.c_str(),
-		    static_cast<configSTACK_DEPTH_TYPE>(stackBytes),
-		    control.get(),
-		    control->config.priority,
-		    &control->taskHandle,
-		    control->config.coreId,
-		    kExternalStackCaps
-		);
-		control->createdWithCaps = (createResult == pdPASS);
+bool ESPWorker::acquireStaticSlotLocked(WorkerHandler::Impl &control) {
+#if ESPWORKER_CAN_USE_STATIC_TASKS
+	for (size_t i = 0; i < _staticSlots.size(); ++i) {
+		if (_staticSlots[i].state == StaticSlot::State::Free) {
+			_staticSlots[i].state = StaticSlot::State::Busy;
+			control.staticSlot = static_cast<int>(i);
+			return true;
+		}
+	}
+
+	// Retired tasks park themselves suspended. Deleting a task that is not running frees it
+	// immediately, after which its TCB and stack can be handed to the next job.
+	for (size_t i = 0; i < _staticSlots.size(); ++i) {
+		StaticSlot &slot = _staticSlots[i];
+		if (slot.state != StaticSlot::State::Retiring) {
+			continue;
+		}
+		TaskHandle_t task = reinterpret_cast<TaskHandle_t>(slot.tcb);
+		if (eTaskGetState(task) != eSuspended) {
+			continue;
+		}
+		vTaskDelete(task);
+		slot.state = StaticSlot::State::Busy;
+		control.staticSlot = static_cast<int>(i);
+		return true;
+	}
 #else
-		createResult = pdFAIL;
+	(void)control;
 #endif
-	} else {
-		createResult = xTaskCreatePinnedToCore(
-		    taskTrampoline,
-		    control->config.name.c_str(),
-		    static_cast<uint32_t>(stackBytes),
-		    control.get(),
-		    control->config.priority,
-		    &control->taskHandle,
-		    control->config.coreId
-		);
-		control->createdWithCaps = false;
+	control.staticSlot = -1;
+	return false;
+}
+
+void ESPWorker::retireStaticSlot(int index) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	if (index >= 0 && static_cast<size_t>(index) < _staticSlots.size()) {
+		_staticSlots[index].state = StaticSlot::State::Retiring;
+	}
+}
+
+void ESPWorker::setPoolSlotStateLocked(PoolSlot &slot, PoolSlot::State state) {
+	if (slot.state == PoolSlot::State::Idle) {
+		_diagTotals.idleWorkers--;
 	}
+	if (state == PoolSlot::State::Idle) {
+		_diagTotals.idleWorkers++;
+	}
+	slot.state = state;
+}
+
+void ESPWorker::dispatchPooledLocked(TaskHandle_t *wakeTask, PoolSlot **growSlot) {
+	// Tasks already claimed will each take one queued job; act only on the jobs beyond that.
+	size_t claimed = 0;
+	for (const auto &slot : _poolSlots) {
+		if (slot.state == PoolSlot::State::Claimed) {
+			claimed++;
+		}
+	}
+	if (_poolQueue.size() <= claimed) {
+		return;
+	}
+
+	for (auto &slot : _poolSlots) {
+		if (slot.state == PoolSlot::State::Idle) {
+			// Claiming the task keeps it from timing out before it sees the notification.
+			setPoolSlotStateLocked(slot, PoolSlot::State::Claimed);
+			*wakeTask = slot.task;
+			return;
+		}
+	}
+
+	if (_diagTotals.poolWorkers >= _config.maxWorkers) {
+		return;
+	}
+	if (governorEnabled() && !hasStackHeadroom(_config.stackSizeBytes, false)) {
+		return;
+	}
+	for (auto &slot : _poolSlots) {
+		if (slot.state == PoolSlot::State::Free) {
+			slot.owner = this;
+			slot.task = nullptr;
+			setPoolSlotStateLocked(slot, PoolSlot::State::Claimed);
+			_diagTotals.poolWorkers++;
+			*growSlot = &slot;
+			return;
+		}
+	}
+}
 
+bool ESPWorker::startPoolWorker(PoolSlot &slot) {
+	char name[kESPWorkerNameCapacity];
+	snprintf(name, sizeof(name), "pool-%u", static_cast<unsigned>(&slot - _poolSlots.data()));
+
+	TaskHandle_t task = nullptr;
+	BaseType_t createResult = xTaskCreatePinnedToCore(
+	    poolTaskTrampoline,
+	    name,
+	    static_cast<uint32_t>(_config.stackSizeBytes),
+	    &slot,
+	    _config.priority,
+	    &task,
+	    _config.coreId
+	);
+
+	std::lock_guard<std::mutex> guard(_mutex);
 	if (createResult != pdPASS) {
+		if (slot.state != PoolSlot::State::Free) {
+			setPoolSlotStateLocked(slot, PoolSlot::State::Free);
+			_diagTotals.poolWorkers--;
+		}
+		publishDiagLocked();
+		return false;
+	}
+	if (slot.state != PoolSlot::State::Free && !slot.task) {
+		slot.task = task;
+	}
+	_diagTotals.poolGrows++;
+	publishDiagLocked();
+	return true;
+}
+
+void ESPWorker::poolTaskTrampoline(void *arg) {
+	auto *slot = static_cast<PoolSlot *>(arg);
+	if (slot && slot->owner) {
+		slot->owner->runPoolWorker(*slot);
+	}
+	vTaskDelete(nullptr);
+}
+
+void ESPWorker::runPoolWorker(PoolSlot &slot) {
+	const TickType_t idleTicks =
+	    _config.idleTimeoutMs > 0 ? pdMS_TO_TICKS(_config.idleTimeoutMs) : portMAX_DELAY;
+	std::atomic<TaskHandle_t> *isrWaiter =
+	    _isrWaiters ? &_isrWaiters[&slot - _poolSlots.data()] : nullptr;
+	bool timedOut = false;
+	bool isrTurn = false; // alternates with queued jobs so neither source starves the other
+
+	while (true) {
+		JobRef job;
+		bool revoked = false;
+		bool exit = false;
+		bool isrWork = false;
 		{
 			std::lock_guard<std::mutex> guard(_mutex);
-			_activeControls.erase(
-			    std::remove_if(
-			        _activeControls.begin(),
-			        _activeControls.end(),
-			        [&](const auto &ptr) { return ptr.get() == control.get(); }
-			    ),
-			    _activeControls.end()
-			);
+			if (slot.state == PoolSlot::State::Free) {
+				revoked = true;
+			} else if ((isrTurn || _poolQueue.empty()) && isrPending()) {
+				slot.task = xTaskGetCurrentTaskHandle();
+				setPoolSlotStateLocked(slot, PoolSlot::State::Busy);
+				publishDiagLocked();
+				isrWork = true;
+			} else if (!_poolQueue.empty()) {
+				slot.task = xTaskGetCurrentTaskHandle();
+				job = std::move(_poolQueue.front());
+				_poolQueue.erase(_poolQueue.begin());
+				setPoolSlotStateLocked(slot, PoolSlot::State::Busy);
+				job->waitingForWorker = false;
+				job->taskHandle = slot.task;
+				job->startTick = xTaskGetTickCount();
+				if (job->tracked) {
+					trackRunningLocked(*job);
+				}
+				publishDiagLocked();
+			} else if (timedOut && slot.state == PoolSlot::State::Idle &&
+			           _diagTotals.poolWorkers > _config.minWorkers) {
+				setPoolSlotStateLocked(slot, PoolSlot::State::Free);
+				slot.task = nullptr;
+				_diagTotals.poolWorkers--;
+				_diagTotals.poolShrinks++;
+				publishDiagLocked();
+				exit = true;
+			} else if (slot.state != PoolSlot::State::Idle) {
+				slot.task = xTaskGetCurrentTaskHandle();
+				setPoolSlotStateLocked(slot, PoolSlot::State::Idle);
+				publishDiagLocked();
+			}
+		}
+
+		if (revoked) {
+			// destroy() deletes this task next; deinit() from one of our own jobs does not.
+			if (_initialized.load(std::memory_order_acquire)) {
+				vTaskSuspend(nullptr);
+			}
+			return;
+		}
+		if (exit) {
+			return;
+		}
+		if (job) {
+			runPooledJob(std::move(job));
+			timedOut = false;
+			isrTurn = true;
+			continue;
+		}
+		if (isrWork) {
+			runIsrJob();
+			timedOut = false;
+			isrTurn = false;
+			continue;
 		}
 
-		notifyError(WorkerError::TaskCreateFailed);
-		return {WorkerError::TaskCreateFailed, {}, "Failed to create worker task"};
+		if (isrWaiter) {
+			// Park before the final check so a submission racing with it still finds this task.
+			isrWaiter->store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (isrPending()) {
+				isrWaiter->store(nullptr, std::memory_order_release);
+				timedOut = false;
+				continue;
+			}
+		}
+		timedOut = ulTaskNotifyTake(pdTRUE, idleTicks) == 0;
+		if (isrWaiter && !isrWaiter->exchange(nullptr, std::memory_order_acq_rel)) {
+			timedOut = false; // an ISR took the handle, so its notification is pending or consumed
+		}
 	}
+}
 
-	control->running.store(true, std::memory_order_release);
-	control->startTick = xTaskGetTickCount();
+void ESPWorker::runPooledJob(JobRef control) {
+	markStarted(*control);
+	const bool boosted = control->config.priority != _config.priority;
+	if (boosted) {
+		vTaskPrioritySet(nullptr, control->config.priority);
+	}
+	runTask(std::move(control));
+	if (boosted) {
+		vTaskPrioritySet(nullptr, _config.priority);
+	}
+}
 
-	auto handler = std::shared_ptr<WorkerHandler>(new WorkerHandler(control));
-	notifyEvent(WorkerEvent::Created);
-	return {WorkerError::None, handler, nullptr};
+void ESPWorker::setupIsrRingLocked() {
+	if (_config.isrQueueDepth == 0 || _poolSlots.empty()) {
+		return;
+	}
+	size_t capacity = 1;
+	while (capacity < _config.isrQueueDepth) {
+		capacity <<= 1;
+	}
+	auto *ring = static_cast<IsrJob *>(heap_caps_malloc(capacity * sizeof(IsrJob), kInternalCaps));
+	auto *waiters = static_cast<std::atomic<TaskHandle_t> *>(
+	    heap_caps_malloc(_poolSlots.size() * sizeof(std::atomic<TaskHandle_t>), kInternalCaps)
+	);
+	if (!ring || !waiters) {
+		heap_caps_free(ring);
+		heap_caps_free(waiters);
+		return;
+	}
+	for (size_t i = 0; i < capacity; ++i) {
+		new (&ring[i]) IsrJob();
+		ring[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < _poolSlots.size(); ++i) {
+		new (&waiters[i]) std::atomic<TaskHandle_t>(nullptr);
+	}
+	_isrEnqueuePos.store(0, std::memory_order_relaxed);
+	_isrDequeuePos.store(0, std::memory_order_relaxed);
+	_isrMask = capacity - 1;
+	_isrWaiters = waiters;
+	_isrRing = ring;
+}
+
+void ESPWorker::releaseIsrRingLocked() {
+	if (!_isrRing) {
+		return;
+	}
+	// Callbacks still queued are dropped; they own nothing we could release.
+	heap_caps_free(_isrRing);
+	heap_caps_free(_isrWaiters);
+	_isrRing = nullptr;
+	_isrWaiters = nullptr;
+	_isrMask = 0;
+}
+
+bool ESPWorker::isrPending() const {
+	if (!_isrRing) {
+		return false;
+	}
+	size_t pos = _isrDequeuePos.load(std::memory_order_relaxed);
+	return _isrRing[pos & _isrMask].sequence.load(std::memory_order_acquire) == pos + 1;
+}
+
+bool ESPWorker::runIsrJob() {
+	if (!_isrRing) {
+		return false;
+	}
+	size_t pos = _isrDequeuePos.load(std::memory_order_relaxed);
+	IsrJob *cell = nullptr;
+	while (true) {
+		cell = &_isrRing[pos & _isrMask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+		if (diff == 0) {
+			if (_isrDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return false; // empty
+		} else {
+			pos = _isrDequeuePos.load(std::memory_order_relaxed);
+		}
+	}
+	IsrCallback callback = cell->callback;
+	void *arg = cell->arg;
+	cell->sequence.store(pos + _isrMask + 1, std::memory_order_release);
+
+	callback(arg);
+	_counters.isrCompleted.fetch_add(1, std::memory_order_relaxed);
+	return true;
 }
 
 void ESPWorker::taskTrampoline(void *arg) {
@@ -399,28 +2308,496 @@ void ESPWorker::taskTrampoline(void *arg) {
 		return;
 	}
 	const bool createdWithCaps = controlPtr->createdWithCaps;
+	const int staticSlot = controlPtr->staticSlot;
 
-	std::shared_ptr<WorkerHandler::Impl> control = controlPtr->self.lock();
-	if (!control || !control->owner) {
+	// The job is still listed in _activeControls: destroying it or deinit() deletes this task
+	// before its last reference goes.
+	JobRef control(controlPtr);
+	ESPWorker *owner = control->owner.load(std::memory_order_acquire);
+	if (!owner) {
 		vTaskDelete(nullptr);
 		return;
 	}
-
-	control->owner->notifyEvent(WorkerEvent::Started);
-	control->owner->runTask(std::move(control));
-	deleteCurrentTask(createdWithCaps);
+
+	owner->markStarted(*control);
+	owner->runTask(std::move(control));
+
+	if (staticSlot >= 0) {
+		// A static task cannot release its own TCB. Park suspended; the next spawn that needs
+		// the slot deletes the task while it is not running. Never resumed on target.
+		owner->retireStaticSlot(staticSlot);
+		vTaskSuspend(nullptr);
+		return;
+	}
+	deleteCurrentTask(createdWithCaps);
+}
+
+void ESPWorker::markStarted(WorkerHandler::Impl &control) {
+	control.runCore.store(xPortGetCoreID(), std::memory_order_release);
+	_counters.started.fetch_add(1, std::memory_order_relaxed);
+	bool supervised = true;
+	if (control.config.timeoutMs > 0) {
+		std::lock_guard<std::mutex> guard(_mutex);
+		supervised = superviseLocked(control);
+	}
+	if (!supervised) {
+		notifyError(WorkerError::NoMemory);
+	}
+	notifyEvent(WorkerEvent::Started);
+}
+
+bool ESPWorker::ensureSupervisorLocked() {
+	if (!_supervisorTimer) {
+		_supervisorTimer =
+		    xTimerCreate("worker-sup", 1, pdFALSE, this, &ESPWorker::supervisorTimerCallback);
+	}
+	return _supervisorTimer != nullptr;
+}
+
+bool ESPWorker::superviseLocked(WorkerHandler::Impl &control) {
+	if (!ensureSupervisorLocked()) {
+		return false;
+	}
+	control.deadline = xTaskGetTickCount() + pdMS_TO_TICKS(control.config.timeoutMs);
+	control.supervised = true;
+	if (!_supervisorArmed ||
+	    static_cast<int32_t>(control.deadline - _supervisorDeadline) < 0) {
+		armSupervisorLocked(control.deadline);
+	}
+	return true;
+}
+
+void ESPWorker::armSupervisorLocked(TickType_t deadline) {
+	TickType_t now = xTaskGetTickCount();
+	TickType_t ticks = deadlinePassed(now, deadline) ? 1 : deadline - now;
+	// Block time 0: the timer command queue is never waited on while _mutex is held.
+	_supervisorArmed = xTimerChangePeriod(_supervisorTimer, ticks, 0) == pdPASS;
+	_supervisorDeadline = deadline;
+}
+
+void ESPWorker::supervisorTimerCallback(TimerHandle_t timer) {
+	auto *owner = static_cast<ESPWorker *>(pvTimerGetTimerID(timer));
+	if (owner) {
+		owner->superviseJobs();
+	}
+}
+
+void ESPWorker::superviseJobs() {
+	std::vector<JobRef> expired;
+	std::vector<JobRef> retries;
+	struct DebouncedJob {
+		uint32_t key;
+		TaskCallback callback;
+		WorkerConfig config;
+	};
+	std::vector<DebouncedJob> debounced;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		_supervisorArmed = false;
+		if (!_supervisorTimer) {
+			return;
+		}
+		const TickType_t now = xTaskGetTickCount();
+		bool rearm = false;
+		TickType_t next = 0;
+		auto keepEarliest = [&](TickType_t deadline) {
+			if (!rearm || static_cast<int32_t>(deadline - next) < 0) {
+				next = deadline;
+				rearm = true;
+			}
+		};
+		for (const auto &control : _activeControls) {
+			if (!control) {
+				continue;
+			}
+			if (control->retryWaiting.load(std::memory_order_relaxed)) {
+				if (deadlinePassed(now, control->retryAt)) {
+					control->retryWaiting.store(false, std::memory_order_release);
+					retries.push_back(control);
+				} else {
+					keepEarliest(control->retryAt);
+				}
+				continue;
+			}
+			if (!control->supervised || control->timedOut.load()) {
+				continue;
+			}
+			if (deadlinePassed(now, control->deadline)) {
+				control->timedOut.store(true, std::memory_order_release);
+				expired.push_back(control);
+				if (control->named) {
+					WorkerNameStats *stats = nameStatsLocked(control->config.name);
+					if (stats) {
+						stats->timeouts++;
+					}
+				}
+			} else {
+				keepEarliest(control->deadline);
+			}
+		}
+		for (auto &slot : _rateSlots) {
+			if (!slot.stats.pending) {
+				continue;
+			}
+			if (deadlinePassed(now, slot.tick)) {
+				slot.stats.pending = false;
+				slot.stats.accepted++;
+				debounced.push_back({slot.stats.key, std::move(slot.callback), slot.config});
+				slot.callback = nullptr;
+			} else {
+				keepEarliest(slot.tick);
+			}
+		}
+		if (rearm) {
+			armSupervisorLocked(next);
+		}
+	}
+
+	// Runs on the timer service task: event and error callbacks should stay short.
+	for (const auto &control : expired) {
+		_counters.timedOut.fetch_add(1, std::memory_order_relaxed);
+		notifyEvent(WorkerEvent::TimedOut);
+		switch (control->config.timeoutPolicy) {
+		case WorkerTimeoutPolicy::RequestStop:
+			control->stopRequested.store(true, std::memory_order_release);
+			break;
+		case WorkerTimeoutPolicy::Destroy:
+			destroyWorker(control);
+			break;
+		default:
+			break;
+		}
+	}
+	for (const auto &control : retries) {
+		relaunchJob(control);
+	}
+	for (auto &job : debounced) {
+		WorkerResult result =
+		    spawnInternal(std::move(job.callback), job.config, nullptr, SpawnMode::Timer);
+		if (result.error != WorkerError::None) {
+			std::lock_guard<std::mutex> guard(_mutex);
+			unacceptRateLocked(job.key, WorkerRateMode::Debounce, 0, 0);
+		}
+	}
+}
+
+bool ESPWorker::scheduleRetryLocked(WorkerHandler::Impl &control) {
+	if (control.attempts.load(std::memory_order_relaxed) >= control.config.retry.maxAttempts ||
+	    !ensureSupervisorLocked()) {
+		return false;
+	}
+	if (control.waitingForWorker) {
+		control.waitingForWorker = false;
+		_poolQueue.erase(
+		    std::remove_if(
+		        _poolQueue.begin(),
+		        _poolQueue.end(),
+		        [&](const auto &ptr) { return ptr.get() == &control; }
+		    ),
+		    _poolQueue.end()
+		);
+	}
+	if (control.trackedRunning) {
+		untrackRunningLocked(control);
+	}
+	if (control.staticSlot >= 0) {
+		_staticSlots[control.staticSlot].state = StaticSlot::State::Free;
+		control.staticSlot = -1;
+	}
+	control.taskHandle = nullptr;
+	control.supervised = false;
+	control.retryAt = xTaskGetTickCount() + retryDelayLocked(control);
+	control.retryWaiting.store(true, std::memory_order_release);
+	if (!_supervisorArmed || static_cast<int32_t>(control.retryAt - _supervisorDeadline) < 0) {
+		armSupervisorLocked(control.retryAt);
+	}
+	return true;
+}
+
+TickType_t ESPWorker::retryDelayLocked(const WorkerHandler::Impl &control) {
+	const WorkerRetryPolicy &retry = control.config.retry;
+	const float maxDelayMs = static_cast<float>(retry.maxDelayMs);
+	const uint8_t attempts = control.attempts.load(std::memory_order_relaxed);
+	float delayMs = static_cast<float>(retry.baseDelayMs);
+	for (uint8_t i = 1; i < attempts && delayMs < maxDelayMs; ++i) {
+		delayMs *= retry.multiplier;
+	}
+	delayMs = std::min(delayMs, maxDelayMs);
+	if (retry.jitterPercent > 0) {
+		_retrySeed ^= _retrySeed << 13;
+		_retrySeed ^= _retrySeed >> 17;
+		_retrySeed ^= _retrySeed << 5;
+		float spread = delayMs * static_cast<float>(std::min<uint8_t>(retry.jitterPercent, 100)) /
+		               100.0f;
+		// Uniform in [-spread, +spread].
+		delayMs += spread * (static_cast<float>(_retrySeed % 2001u) / 1000.0f - 1.0f);
+	}
+	TickType_t ticks = pdMS_TO_TICKS(static_cast<uint32_t>(delayMs));
+	return ticks > 0 ? ticks : 1;
+}
+
+bool ESPWorker::retryAfterRun(
+    const JobRef &control, TaskCallback &callback
+) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	if (!_initialized.load(std::memory_order_acquire) ||
+	    control->finalized.load(std::memory_order_acquire)) {
+		return false;
+	}
+	// The finishing task still owns its static slot and retires it on the way out.
+	control->staticSlot = -1;
+	if (!scheduleRetryLocked(*control)) {
+		return false;
+	}
+	control->callback = std::move(callback);
+	// takeFollowUp() closed the job; it accepts merges again while it waits for the retry.
+	control->coalesceOpen = control->config.coalesceKey != 0 && !control->detached;
+	publishDiagLocked();
+	return true;
+}
+
+void ESPWorker::retryLaunch(
+    const JobRef &control, WorkerError error
+) {
+	bool retrying = false;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		retrying = scheduleRetryLocked(*control);
+		publishDiagLocked();
+	}
+	notifyError(error);
+	if (!retrying) {
+		finalizeWorker(control, true);
+	}
+}
+
+void ESPWorker::relaunchJob(const JobRef &control) {
+	bool launch = false;
+	bool noHeadroom = false;
+	TaskHandle_t wakeTask = nullptr;
+	PoolSlot *growSlot = nullptr;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (!_initialized.load(std::memory_order_acquire) ||
+		    control->finalized.load(std::memory_order_acquire)) {
+			return;
+		}
+		control->attempts.fetch_add(1, std::memory_order_relaxed);
+		control->failed.store(false, std::memory_order_relaxed);
+		control->timedOut.store(false, std::memory_order_relaxed);
+		control->stopRequested.store(false, std::memory_order_relaxed);
+		control->runCore.store(-1, std::memory_order_release);
+		control->startTick = xTaskGetTickCount();
+		if (control->pooled) {
+			control->waitingForWorker = true;
+			_poolQueue.push_back(control);
+			dispatchPooledLocked(&wakeTask, &growSlot);
+			noHeadroom = !wakeTask && !growSlot && _diagTotals.poolWorkers == 0;
+		} else {
+			const WorkerConfig &config = control->config;
+			noHeadroom = (_config.staticAllocation && !acquireStaticSlotLocked(*control)) ||
+			             (governorEnabled() &&
+			              !hasStackHeadroom(config.stackSizeBytes, config.useExternalStack));
+			if (!noHeadroom && control->tracked) {
+				trackRunningLocked(*control);
+			}
+			launch = !noHeadroom;
+		}
+		publishDiagLocked();
+	}
+	_counters.retries.fetch_add(1, std::memory_order_relaxed);
+
+	if (noHeadroom) {
+		retryLaunch(control, WorkerError::InsufficientMemory);
+		return;
+	}
+	if (wakeTask) {
+		xTaskNotifyGive(wakeTask);
+	}
+	if (growSlot && !startPoolWorker(*growSlot)) {
+		bool stranded = false;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			stranded = _diagTotals.poolWorkers == 0 && control->waitingForWorker;
+		}
+		if (stranded) {
+			retryLaunch(control, WorkerError::TaskCreateFailed);
+		} else {
+			notifyError(WorkerError::TaskCreateFailed);
+		}
+	}
+	if (!launch) {
+		return;
+	}
+	const WorkerError failure = createTask(*control);
+	if (failure != WorkerError::None) {
+		retryLaunch(control, failure);
+	}
+}
+
+WorkerNameStats *ESPWorker::nameStatsLocked(const WorkerName &name) {
+	for (auto &stats : _nameStats) {
+		if (stats.name == name) {
+			return &stats;
+		}
+	}
+	if (_nameStats.size() >= _config.nameStatsCapacity) {
+		return nullptr;
+	}
+	_nameStats.push_back(WorkerNameStats{});
+	_nameStats.back().name = name;
+	return &_nameStats.back();
+}
+
+const WorkerNameStats *ESPWorker::findNameStatsLocked(const WorkerName &name) const {
+	for (const auto &stats : _nameStats) {
+		if (stats.name == name) {
+			return &stats;
+		}
+	}
+	return nullptr;
+}
+
+size_t ESPWorker::getNameStats(WorkerNameStats *out, size_t capacity) const {
+	std::lock_guard<std::mutex> guard(_mutex);
+	size_t count = std::min(capacity, _nameStats.size());
+	for (size_t i = 0; out && i < count; ++i) {
+		out[i] = _nameStats[i];
+	}
+	return out ? count : 0;
+}
+
+bool ESPWorker::nameStatsAt(size_t index, WorkerNameStats *out) const {
+	std::lock_guard<std::mutex> guard(_mutex);
+	if (index >= _nameStats.size()) {
+		return false;
+	}
+	*out = _nameStats[index];
+	return true;
+}
+
+WorkerNameStats ESPWorker::getNameStats(const char *name) const {
+	WorkerName key(name);
+	std::lock_guard<std::mutex> guard(_mutex);
+	for (const auto &stats : _nameStats) {
+		if (stats.name == key) {
+			return stats;
+		}
+	}
+	WorkerNameStats empty{};
+	empty.name = key;
+	return empty;
+}
+
+bool ESPWorker::stopRequested() {
+	return t_stopFlag && t_stopFlag->load(std::memory_order_acquire);
+}
+
+void ESPWorker::reportFailure() {
+	if (t_failFlag) {
+		t_failFlag->store(true, std::memory_order_release);
+	}
+}
+
+void ESPWorker::countAllocation() {
+	if (t_allocationCount) {
+		t_allocationCount->fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+ESPWorker::JobRef
+ESPWorker::coalesceLocked(const WorkerConfig &config, TaskCallback &callback) {
+	for (const auto &control : _activeControls) {
+		if (!control || !control->coalesceOpen ||
+		    control->config.coalesceKey != config.coalesceKey) {
+			continue;
+		}
+		// A job that has not taken its callback yet runs it once; a running job gets a single
+		// follow-up run, which later submissions merge into the same way.
+		if (!control->callback || config.coalesceLatestWins) {
+			control->callback = std::move(callback);
+		}
+		control->coalesced.fetch_add(1, std::memory_order_relaxed);
+		_counters.coalesced.fetch_add(1, std::memory_order_relaxed);
+		return control;
+	}
+	return nullptr;
+}
+
+ESPWorker::TaskCallback ESPWorker::takeCallback(WorkerHandler::Impl &control) {
+	if (control.config.coalesceKey == 0) {
+		return std::move(control.callback);
+	}
+	// Coalescing spawns write the callback under the lock.
+	std::lock_guard<std::mutex> guard(_mutex);
+	return std::move(control.callback);
+}
+
+bool ESPWorker::takeFollowUp(WorkerHandler::Impl &control, TaskCallback &callback) {
+	std::lock_guard<std::mutex> guard(_mutex);
+	if (!control.callback || control.stopRequested.load(std::memory_order_acquire)) {
+		// Later spawns with the key start a new job.
+		control.coalesceOpen = false;
+		return false;
+	}
+	callback = std::move(control.callback);
+	control.failed.store(false, std::memory_order_release);
+	return true;
 }
 
-void ESPWorker::runTask(std::shared_ptr<WorkerHandler::Impl> control) {
-	auto callback = std::move(control->callback);
+void ESPWorker::invokeJob(WorkerHandler::Impl &control, const TaskCallback &callback) {
+	uint32_t cpuTimeUs = 0;
 	if (callback) {
+		const bool trackHeap = control.config.trackHeap;
+		const size_t internalFree = trackHeap ? heap_caps_get_free_size(kInternalCaps) : 0;
+		const size_t psramFree = trackHeap ? psramFreeBytes() : 0;
+		const uint32_t runTimeStart = currentTaskRunTime(); // sampled like the end below
+		// Restored afterwards: an inline job may run inside another job's callback.
+		auto *outerStop = t_stopFlag;
+		auto *outerFail = t_failFlag;
+		auto *outerAllocations = t_allocationCount;
+		t_stopFlag = &control.stopRequested;
+		t_failFlag = &control.failed;
+		t_allocationCount = trackHeap ? &control.heapAllocations : nullptr;
 		invokeWorkerCallback(callback);
+		t_stopFlag = outerStop;
+		t_failFlag = outerFail;
+		t_allocationCount = outerAllocations;
+		cpuTimeUs = currentTaskRunTime() - runTimeStart;
+		if (trackHeap) {
+			control.internalHeapDelta.fetch_add(
+			    static_cast<int32_t>(internalFree - heap_caps_get_free_size(kInternalCaps)),
+			    std::memory_order_relaxed
+			);
+			control.psramHeapDelta.fetch_add(
+			    static_cast<int32_t>(psramFree - psramFreeBytes()), std::memory_order_relaxed
+			);
+		}
+	}
+	const BaseType_t core = xPortGetCoreID();
+	control.runCore.store(core, std::memory_order_release);
+	control.cpuTimeUs.fetch_add(cpuTimeUs, std::memory_order_relaxed);
+	if (static_cast<size_t>(core) < kESPWorkerCoreCount) {
+		_counters.cpuTimeUs[core].fetch_add(cpuTimeUs, std::memory_order_relaxed);
+	}
+}
+
+void ESPWorker::runTask(JobRef control) {
+	auto callback = takeCallback(*control);
+	invokeJob(*control, callback);
+	while (control->config.coalesceKey != 0 && takeFollowUp(*control, callback)) {
+		invokeJob(*control, callback);
+	}
+	const bool failed = control->failed.load(std::memory_order_acquire) ||
+	                    control->timedOut.load(std::memory_order_acquire);
+	if (failed && callback && retryAfterRun(control, callback)) {
+		return;
 	}
 	finalizeWorker(control, false);
 }
 
 void ESPWorker::finalizeWorker(
-    const std::shared_ptr<WorkerHandler::Impl> &control, bool destroyed
+    const JobRef &control, bool destroyed
 ) {
 	if (!control) {
 		return;
@@ -434,31 +2811,193 @@ void ESPWorker::finalizeWorker(
 	control->destroyed.store(destroyed, std::memory_order_release);
 	control->running.store(false, std::memory_order_release);
 	control->endTick = xTaskGetTickCount();
+	if (control->mailbox) {
+		control->mailbox->close();
+	}
 
+	// Stack about to return to the heap, credited to the admission queue below.
+	size_t releasedBytes = 0;
 	if (control->taskHandle) {
+		if (control->staticSlot < 0 && !control->pooled) {
+			releasedBytes = control->config.stackSizeBytes;
+		}
 		control->taskHandle = nullptr;
 	}
 
-	if (control->completion) {
-		xSemaphoreGive(control->completion);
+	(destroyed ? _counters.destroyed : _counters.completed).fetch_add(1, std::memory_order_relaxed);
+	const BaseType_t runCore = control->runCore.load(std::memory_order_acquire);
+	if (runCore >= 0 && static_cast<size_t>(runCore) < kESPWorkerCoreCount &&
+	    control->endTick >= control->startTick) {
+		uint32_t runtimeMs =
+		    static_cast<uint32_t>((control->endTick - control->startTick) * portTICK_PERIOD_MS);
+		_counters.busyTimeMs[runCore].fetch_add(runtimeMs, std::memory_order_relaxed);
 	}
 
 	{
 		std::lock_guard<std::mutex> guard(_mutex);
-		_activeControls.erase(
-		    std::remove_if(
-		        _activeControls.begin(),
-		        _activeControls.end(),
-		        [&](const auto &ptr) { return ptr.get() == control.get(); }
-		    ),
-		    _activeControls.end()
-		);
+		completeLocked(*control);
+	}
+	if (control->batch) {
+		control->batch->finishOne();
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (eraseControlLocked(control.get())) {
+			publishDiagLocked();
+		}
+		if (control->config.tag != 0) {
+			TagState &tag = _tags[control->config.tag];
+			(destroyed ? tag.destroyed : tag.completed)++;
+		}
+		WorkerNameStats *stats = control->named ? nameStatsLocked(control->config.name) : nullptr;
+		if (stats) {
+			uint32_t runtimeMs = 0;
+			if (static_cast<int32_t>(control->endTick - control->startTick) > 0) {
+				runtimeMs = static_cast<uint32_t>(
+				    (control->endTick - control->startTick) * portTICK_PERIOD_MS
+				);
+			}
+			size_t bucket = 0;
+			while (bucket < kESPWorkerRuntimeBucketCount &&
+			       runtimeMs > kESPWorkerRuntimeBucketMs[bucket]) {
+				bucket++;
+			}
+			const uint32_t cpuTimeUs = control->cpuTimeUs.load(std::memory_order_relaxed);
+			if (!destroyed) {
+				// Seeded by the first sample, then moves a quarter of the way to each new one.
+				int64_t ewma = stats->completed == 0 ? cpuTimeUs : stats->cpuTimeUsEwma;
+				ewma += (static_cast<int64_t>(cpuTimeUs) - ewma) / 4;
+				stats->cpuTimeUsEwma = static_cast<uint32_t>(ewma);
+				stats->completed++;
+			}
+			stats->finished++;
+			stats->runtimeMsSum += runtimeMs;
+			stats->cpuTimeUsSum += cpuTimeUs;
+			stats->internalHeapDeltaSum +=
+			    control->internalHeapDelta.load(std::memory_order_relaxed);
+			stats->psramHeapDeltaSum += control->psramHeapDelta.load(std::memory_order_relaxed);
+			stats->heapAllocations += control->heapAllocations.load(std::memory_order_relaxed);
+			stats->runtimeBuckets[bucket]++;
+		}
 	}
 
 	notifyEvent(destroyed ? WorkerEvent::Destroyed : WorkerEvent::Completed);
+	admitDeferred(releasedBytes, control->config.useExternalStack);
+}
+
+bool ESPWorker::waitCompletion(WorkerHandler::Impl &control, TickType_t ticks) {
+	WorkerHandler::Impl::Waiter waiter{xTaskGetCurrentTaskHandle(), nullptr, false};
+	uint32_t spinUs = 0;
+	{
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (control.completed.load(std::memory_order_relaxed) ||
+		    !control.running.load(std::memory_order_acquire)) {
+			return true;
+		}
+		if (ticks == 0) {
+			return false;
+		}
+		spinUs = spinBudgetLocked(control);
+		if (spinUs == 0) {
+			waiter.next = control.waiters;
+			control.waiters = &waiter;
+		}
+	}
+
+	if (spinUs > 0) {
+		// A job about to finish on the other core ends sooner than a block and wake-up would.
+		_counters.spinWaits.fetch_add(1, std::memory_order_relaxed);
+		const int64_t spinStart = spinClockUs();
+		while (control.running.load(std::memory_order_acquire)) {
+			if (spinClockUs() - spinStart >= spinUs) {
+				break;
+			}
+		}
+		std::lock_guard<std::mutex> guard(_mutex);
+		if (control.completed.load(std::memory_order_relaxed) ||
+		    !control.running.load(std::memory_order_acquire)) {
+			_counters.spinJoins.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		waiter.next = control.waiters;
+		control.waiters = &waiter;
+	}
+
+	// The notification value is shared with whatever else the task uses it for: wake-ups that
+	// arrive before completeLocked() marks the waiter are counted and given back at the end.
+	const TickType_t start = xTaskGetTickCount();
+	uint32_t foreign = 0;
+	bool woken = false;
+	while (true) {
+		TickType_t remaining = ticks;
+		if (ticks != portMAX_DELAY) {
+			const TickType_t elapsed = xTaskGetTickCount() - start;
+			remaining = elapsed < ticks ? ticks - elapsed : 0;
+		}
+		const bool notified = remaining > 0 && ulTaskNotifyTake(pdFALSE, remaining) > 0;
+		std::lock_guard<std::mutex> guard(_mutex);
+		woken = waiter.woken;
+		if (woken && !notified) {
+			// Completed between the timeout and the lock; its notification is already pending.
+			ulTaskNotifyTake(pdFALSE, 0);
+		}
+		if (woken) {
+			break;
+		}
+		if (!notified) {
+			control.unlinkWaiter(waiter);
+			break;
+		}
+		foreign++;
+	}
+	for (; foreign > 0; --foreign) {
+		xTaskNotifyGive(waiter.task);
+	}
+	return woken || !control.running.load(std::memory_order_acquire);
+}
+
+uint32_t ESPWorker::spinBudgetLocked(const WorkerHandler::Impl &control) const {
+	// Only a job that has started on the other core can finish while the caller polls; one on
+	// this core cannot run until the caller blocks.
+	if (_config.maxSpinWaitUs == 0 || portNUM_PROCESSORS < 2 || !control.taskHandle ||
+	    control.queued || control.waitingForWorker ||
+	    control.taskHandle == xTaskGetCurrentTaskHandle()) {
+		return 0;
+	}
+	const BaseType_t runCore = control.runCore.load(std::memory_order_acquire);
+	if (runCore < 0 || runCore == xPortGetCoreID()) {
+		return 0;
+	}
+#if ESPWORKER_HAS_RUN_TIME_STATS
+	const WorkerNameStats *stats = nullptr;
+	if (control.named) {
+		stats = findNameStatsLocked(control.config.name);
+	}
+	if (stats && stats->completed > 0) {
+		if (stats->cpuTimeUsEwma >= _config.maxSpinWaitUs) {
+			return 0;
+		}
+		return std::min(_config.maxSpinWaitUs, 2 * stats->cpuTimeUsEwma + kSpinSlackUs);
+	}
+#endif
+	return _config.maxSpinWaitUs;
+}
+
+void ESPWorker::completeLocked(WorkerHandler::Impl &control) {
+	control.completed.store(true, std::memory_order_release);
+	control.owner.store(nullptr, std::memory_order_release);
+	// Notified under the lock: a waiter that timed out cannot leave before its node is done.
+	for (auto *waiter = control.waiters; waiter; waiter = waiter->next) {
+		waiter->woken = true;
+		if (waiter->task) {
+			xTaskNotifyGive(waiter->task);
+		}
+	}
+	control.waiters = nullptr;
 }
 
-bool ESPWorker::destroyWorker(const std::shared_ptr<WorkerHandler::Impl> &control) {
+bool ESPWorker::destroyWorker(const JobRef &control) {
 	if (!control) {
 		return false;
 	}
@@ -467,6 +3006,50 @@ bool ESPWorker::destroyWorker(const std::shared_ptr<WorkerHandler::Impl> &contro
 		return true;
 	}
 
+	if (control->pooled) {
+		TaskHandle_t poolTask = nullptr;
+		bool selfDestroy = false;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			if (control->finalized.load(std::memory_order_acquire)) {
+				return true;
+			}
+			if (control->waitingForWorker) {
+				eraseControlLocked(control.get());
+			} else if (control->taskHandle == xTaskGetCurrentTaskHandle()) {
+				selfDestroy = true;
+			} else if (control->taskHandle) {
+				// Killing the job kills its pool task. Revoking the slot first stops the task
+				// from picking up another job before it is deleted.
+				poolTask = control->taskHandle;
+				for (auto &slot : _poolSlots) {
+					if (slot.state != PoolSlot::State::Free && slot.task == poolTask) {
+						setPoolSlotStateLocked(slot, PoolSlot::State::Free);
+						slot.task = nullptr;
+						_diagTotals.poolWorkers--;
+						break;
+					}
+				}
+			}
+			publishDiagLocked();
+		}
+		if (selfDestroy) {
+			notifyError(WorkerError::InvalidConfig);
+			return false;
+		}
+		if (poolTask) {
+			vTaskDelete(poolTask);
+		}
+		finalizeWorker(control, true);
+		return true;
+	}
+
+	if (control->ranInline) {
+		// Still running on its spawner's stack; there is no task to delete.
+		notifyError(WorkerError::InvalidConfig);
+		return false;
+	}
+
 	if (control->taskHandle == nullptr) {
 		finalizeWorker(control, true);
 		return true;
@@ -477,7 +3060,16 @@ bool ESPWorker::destroyWorker(const std::shared_ptr<WorkerHandler::Impl> &contro
 		return false;
 	}
 
-	deleteTaskHandle(control->taskHandle, control->createdWithCaps);
+	// Producers must stop notifying an actor's task before it is deleted.
+	if (control->mailbox) {
+		control->mailbox->close();
+	}
+	if (control->staticSlot >= 0) {
+		vTaskSuspend(control->taskHandle);
+		retireStaticSlot(control->staticSlot);
+	} else {
+		deleteTaskHandle(control->taskHandle, control->createdWithCaps);
+	}
 	finalizeWorker(control, true);
 	return true;
 }
@@ -488,78 +3080,623 @@ size_t ESPWorker::activeWorkers() const {
 }
 
 void ESPWorker::cleanupFinished() {
+	admitDeferred(0, false);
+
 	std::lock_guard<std::mutex> guard(_mutex);
+	bool changed = false;
+	for (auto &control : _activeControls) {
+		if (control && !control->running.load(std::memory_order_acquire)) {
+			untrackControlLocked(*control);
+			changed = true;
+		}
+	}
 	_activeControls.erase(
 	    std::remove_if(
 	        _activeControls.begin(),
 	        _activeControls.end(),
-	        [](const auto &ptr) { return !ptr || !ptr->running.load(std::memory_order_acquire); }
+	        [](const auto &ptr) { return !ptr || !ptr->tracked; }
 	    ),
 	    _activeControls.end()
 	);
+	if (changed) {
+		publishDiagLocked();
+	}
 }
 
-WorkerDiag ESPWorker::getDiag() const {
-	WorkerDiag diag{};
+size_t ESPWorker::destroyTag(uint8_t tag) {
+	if (tag == 0 || tag >= kESPWorkerTagCount) {
+		return 0;
+	}
+	// Destroying takes _mutex, so collect a few jobs at a time and destroy them unlocked. Each
+	// destroyed job unlinks itself; the calling job is skipped so the walk always ends.
+	constexpr size_t kBatch = 8;
+	const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+	size_t destroyed = 0;
+	while (true) {
+		JobRef batch[kBatch];
+		size_t count = 0;
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			for (WorkerHandler::Impl *job = _tags[tag].head; job && count < kBatch;
+			     job = job->tagNext) {
+				if (job->running.load(std::memory_order_acquire) &&
+				    (!job->taskHandle || job->taskHandle != self)) {
+					batch[count++] = JobRef(job);
+				}
+			}
+		}
+		size_t progress = 0;
+		for (size_t i = 0; i < count; ++i) {
+			if (batch[i] && destroyWorker(batch[i])) {
+				progress++;
+			}
+		}
+		destroyed += progress;
+		if (count < kBatch || progress == 0) {
+			return destroyed;
+		}
+	}
+}
 
-	std::vector<std::shared_ptr<WorkerHandler::Impl>> activeControls;
-	{
-		std::lock_guard<std::mutex> guard(_mutex);
-		activeControls = _activeControls;
+bool ESPWorker::waitTag(uint8_t tag, TickType_t ticks) {
+	if (tag == 0 || tag >= kESPWorkerTagCount) {
+		return false;
+	}
+	TagState &state = _tags[tag];
+	const TickType_t start = xTaskGetTickCount();
+	while (true) {
+		{
+			std::lock_guard<std::mutex> guard(_mutex);
+			if (state.jobs == 0) {
+				break;
+			}
+		}
+		TickType_t remaining = ticks;
+		if (ticks != portMAX_DELAY) {
+			TickType_t elapsed = xTaskGetTickCount() - start;
+			if (elapsed >= ticks) {
+				return false;
+			}
+			remaining = ticks - elapsed;
+		}
+		if (!state.drained || xSemaphoreTake(state.drained, remaining) != pdTRUE) {
+			std::lock_guard<std::mutex> guard(_mutex);
+			return state.jobs == 0;
+		}
+	}
+	// Pass the wake-up on to the next waiter on this tag.
+	if (state.drained) {
+		xSemaphoreGive(state.drained);
+	}
+	return true;
+}
+
+WorkerTagDiag ESPWorker::getDiag(uint8_t tag) const {
+	WorkerTagDiag diag{};
+	if (tag >= kESPWorkerTagCount) {
+		return diag;
+	}
+	const TickType_t now = xTaskGetTickCount();
+	std::lock_guard<std::mutex> guard(_mutex);
+	const TagState &state = _tags[tag];
+	diag.spawned = state.spawned;
+	diag.completed = state.completed;
+	diag.destroyed = state.destroyed;
+	for (const WorkerHandler::Impl *job = state.head; job; job = job->tagNext) {
+		diag.jobs++;
+		if (!job->trackedRunning) {
+			diag.waitingJobs++;
+			continue;
+		}
+		diag.runningJobs++;
+		uint32_t runtimeMs = static_cast<uint32_t>((now - job->startTick) * portTICK_PERIOD_MS);
+		diag.maxRuntimeMs = std::max(diag.maxRuntimeMs, runtimeMs);
 	}
+	return diag;
+}
+
+WorkerDiag ESPWorker::getDiag() const {
+	uint32_t totalJobs = 0;
+	uint32_t runningJobs = 0;
+	uint32_t psramStackJobs = 0;
+	uint32_t deferredJobs = 0;
+	uint32_t startTickSum = 0;
+	TickType_t oldestStartTick = 0;
+	uint32_t poolWorkers = 0;
+	uint32_t idleWorkers = 0;
+	uint32_t poolGrows = 0;
+	uint32_t poolShrinks = 0;
+
+	uint32_t version = 0;
+	do {
+		version = _diagVersion.load(std::memory_order_acquire);
+		const DiagSnapshot &snapshot = _diagSnapshots[version & 1u];
+		totalJobs = snapshot.totalJobs.load(std::memory_order_relaxed);
+		runningJobs = snapshot.runningJobs.load(std::memory_order_relaxed);
+		psramStackJobs = snapshot.psramStackJobs.load(std::memory_order_relaxed);
+		deferredJobs = snapshot.deferredJobs.load(std::memory_order_relaxed);
+		startTickSum = snapshot.startTickSum.load(std::memory_order_relaxed);
+		oldestStartTick = snapshot.oldestStartTick.load(std::memory_order_relaxed);
+		poolWorkers = snapshot.poolWorkers.load(std::memory_order_relaxed);
+		idleWorkers = snapshot.idleWorkers.load(std::memory_order_relaxed);
+		poolGrows = snapshot.poolGrows.load(std::memory_order_relaxed);
+		poolShrinks = snapshot.poolShrinks.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while (version != _diagVersion.load(std::memory_order_relaxed));
 
-	diag.totalJobs = activeControls.size();
-	if (activeControls.empty()) {
+	WorkerDiag diag{};
+	diag.totalJobs = totalJobs;
+	diag.runningJobs = runningJobs;
+	diag.psramStackJobs = psramStackJobs;
+	diag.deferredJobs = deferredJobs;
+	diag.poolWorkers = poolWorkers;
+	diag.idleWorkers = idleWorkers;
+	diag.poolGrows = poolGrows;
+	diag.poolShrinks = poolShrinks;
+	if (diag.totalJobs > diag.runningJobs) {
+		diag.waitingJobs = diag.totalJobs - diag.runningJobs;
+	}
+	sampleCoreLoad(false);
+	for (size_t core = 0; core < kESPWorkerCoreCount; ++core) {
+		diag.coreLoadPercent[core] =
+		    _loadSample.coreLoadPercent[core].load(std::memory_order_relaxed);
+	}
+	if (runningJobs == 0) {
 		return diag;
 	}
 
+	// Modular arithmetic: runningJobs * now - sum(start) == sum(now - start) as long as the
+	// combined runtime of the running jobs fits in 32 bits.
 	TickType_t now = xTaskGetTickCount();
-	uint64_t runtimeSum = 0;
-	bool haveRuntime = false;
+	uint32_t runtimeTicksSum = runningJobs * static_cast<uint32_t>(now) - startTickSum;
+	uint64_t runtimeSum = static_cast<uint64_t>(runtimeTicksSum) * portTICK_PERIOD_MS;
+	diag.averageRuntimeMs = static_cast<uint32_t>(runtimeSum / diag.totalJobs);
+	diag.maxRuntimeMs = static_cast<uint32_t>((now - oldestStartTick) * portTICK_PERIOD_MS);
+	return diag;
+}
 
-	for (const auto &control : activeControls) {
-		if (!control) {
+void ESPWorker::trackControlLocked(WorkerHandler::Impl &control) {
+	if (control.tracked) {
+		return;
+	}
+	control.tracked = true;
+	_diagTotals.totalJobs++;
+	linkTagLocked(control);
+	indexNameLocked(control);
+	claimHandleSlotLocked(control);
+	if (control.config.useExternalStack) {
+		_diagTotals.psramStackJobs++;
+	}
+	if (control.queued) {
+		_diagTotals.deferredJobs++;
+	} else if (!control.waitingForWorker && control.running.load(std::memory_order_acquire)) {
+		trackRunningLocked(control);
+	}
+}
+
+void ESPWorker::trackRunningLocked(WorkerHandler::Impl &control) {
+	control.trackedRunning = true;
+	if (_diagTotals.runningJobs == 0) {
+		_diagTotals.oldestStartTick = control.startTick;
+	}
+	_diagTotals.runningJobs++;
+	_diagTotals.startTickSum += static_cast<uint32_t>(control.startTick);
+}
+
+void ESPWorker::promoteDeferredLocked(WorkerHandler::Impl &control) {
+	control.queued = false;
+	control.startTick = xTaskGetTickCount();
+	if (control.tracked) {
+		_diagTotals.deferredJobs--;
+		trackRunningLocked(control);
+	}
+}
+
+void ESPWorker::untrackControlLocked(WorkerHandler::Impl &control) {
+	if (!control.tracked) {
+		return;
+	}
+	control.tracked = false;
+	_diagTotals.totalJobs--;
+	unlinkTagLocked(control);
+	unindexNameLocked(control);
+	releaseHandleSlotLocked(control);
+	if (control.config.useExternalStack) {
+		_diagTotals.psramStackJobs--;
+	}
+	if (control.queued) {
+		_diagTotals.deferredJobs--;
+	}
+
+	if (control.trackedRunning) {
+		untrackRunningLocked(control);
+	}
+}
+
+void ESPWorker::untrackRunningLocked(WorkerHandler::Impl &control) {
+	control.trackedRunning = false;
+	_diagTotals.runningJobs--;
+	_diagTotals.startTickSum -= static_cast<uint32_t>(control.startTick);
+	if (_diagTotals.runningJobs == 0 || control.startTick != _diagTotals.oldestStartTick) {
+		return;
+	}
+
+	TickType_t oldest = 0;
+	bool found = false;
+	for (const auto &ptr : _activeControls) {
+		if (!ptr || !ptr->trackedRunning || ptr.get() == &control) {
 			continue;
 		}
+		if (!found || static_cast<int32_t>(ptr->startTick - oldest) < 0) {
+			oldest = ptr->startTick;
+			found = true;
+		}
+	}
+	_diagTotals.oldestStartTick = oldest;
+}
+
+void ESPWorker::linkTagLocked(WorkerHandler::Impl &control) {
+	if (control.config.tag == 0) {
+		return;
+	}
+	TagState &tag = _tags[control.config.tag];
+	control.tagPrev = nullptr;
+	control.tagNext = tag.head;
+	if (tag.head) {
+		tag.head->tagPrev = &control;
+	}
+	tag.head = &control;
+	tag.jobs++;
+	tag.spawned++;
+}
+
+void ESPWorker::unlinkTagLocked(WorkerHandler::Impl &control) {
+	if (control.config.tag == 0) {
+		return;
+	}
+	TagState &tag = _tags[control.config.tag];
+	if (control.tagPrev) {
+		control.tagPrev->tagNext = control.tagNext;
+	} else {
+		tag.head = control.tagNext;
+	}
+	if (control.tagNext) {
+		control.tagNext->tagPrev = control.tagPrev;
+	}
+	control.tagPrev = nullptr;
+	control.tagNext = nullptr;
+	if (--tag.jobs == 0 && tag.drained) {
+		xSemaphoreGive(tag.drained);
+	}
+}
 
-		bool running = control->running.load(std::memory_order_acquire);
-		if (running) {
-			diag.runningJobs++;
+void ESPWorker::setupNameIndexLocked() {
+	for (auto &slot : _nameIndex) {
+		if (slot.control) {
+			slot.control->indexed = false;
 		}
+	}
+	_nameIndex.clear();
+	if (!_config.indexNames) {
+		return;
+	}
+	size_t slots = 2;
+	while (slots < 2 * jobCapacityLocked()) {
+		slots <<= 1;
+	}
+	_nameIndex.resize(slots);
+	for (auto &control : _activeControls) {
+		if (control && control->tracked) {
+			indexNameLocked(*control);
+		}
+	}
+}
+
+void ESPWorker::indexNameLocked(WorkerHandler::Impl &control) {
+	if (_nameIndex.empty() || !control.named || control.detached || control.indexed) {
+		return;
+	}
+	const size_t mask = _nameIndex.size() - 1;
+	size_t i = control.nameHash & mask;
+	while (_nameIndex[i].control) {
+		i = (i + 1) & mask;
+	}
+	_nameIndex[i] = {&control, control.nameHash};
+	control.indexed = true;
+}
 
-		if (control->config.useExternalStack) {
-			diag.psramStackJobs++;
+void ESPWorker::unindexNameLocked(WorkerHandler::Impl &control) {
+	if (!control.indexed) {
+		return;
+	}
+	control.indexed = false;
+	const size_t mask = _nameIndex.size() - 1;
+	size_t hole = control.nameHash & mask;
+	while (_nameIndex[hole].control != &control) {
+		hole = (hole + 1) & mask;
+	}
+	// Pull later entries of the probe run back into the hole unless their home slot lies
+	// cyclically in (hole, next].
+	for (size_t next = (hole + 1) & mask; _nameIndex[next].control; next = (next + 1) & mask) {
+		size_t home = _nameIndex[next].hash & mask;
+		bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+		if (!stays) {
+			_nameIndex[hole] = _nameIndex[next];
+			hole = next;
 		}
+	}
+	_nameIndex[hole] = {};
+}
 
-		TickType_t endTicks = running ? now : control->endTick;
-		if (endTicks >= control->startTick) {
-			TickType_t elapsedTicks = endTicks - control->startTick;
-			uint32_t runtimeMs = static_cast<uint32_t>(elapsedTicks * portTICK_PERIOD_MS);
-			runtimeSum += runtimeMs;
-			diag.maxRuntimeMs = std::max(diag.maxRuntimeMs, runtimeMs);
-			haveRuntime = true;
+WorkerHandler::Impl *ESPWorker::findNamedLocked(const WorkerName &name, uint32_t hash) const {
+	if (_nameIndex.empty()) {
+		return nullptr;
+	}
+	const size_t mask = _nameIndex.size() - 1;
+	for (size_t i = hash & mask; _nameIndex[i].control; i = (i + 1) & mask) {
+		const NameSlot &slot = _nameIndex[i];
+		if (slot.hash == hash && slot.control->config.name == name &&
+		    slot.control->running.load(std::memory_order_acquire)) {
+			return slot.control;
 		}
 	}
+	return nullptr;
+}
 
-	if (diag.totalJobs > diag.runningJobs) {
-		diag.waitingJobs = diag.totalJobs - diag.runningJobs;
+std::shared_ptr<WorkerHandler> ESPWorker::handlerFor(const JobRef &control) {
+	std::shared_ptr<WorkerHandler> handler = control->handler.lock();
+	if (!handler) {
+		// The caller dropped the original handler; wrap the job in a new one.
+		handler = makeInternalShared<WorkerHandler>(WorkerHandler(control));
 	}
+	return handler;
+}
+
+WorkerResult ESPWorker::existingResult(const JobRef &control) {
+	WorkerResult result{WorkerError::None, handlerFor(control), nullptr, true};
+	result.handle = WorkerHandler(control);
+	std::lock_guard<std::mutex> guard(_mutex);
+	result.slot = slotHandleLocked(*control);
+	return result;
+}
 
-	if (diag.totalJobs > 0 && haveRuntime) {
-		diag.averageRuntimeMs = static_cast<uint32_t>(runtimeSum / diag.totalJobs);
+void ESPWorker::setupHandleSlotsLocked() {
+	for (auto &slot : _handleSlots) {
+		if (slot.control) {
+			slot.control->handleSlot = -1;
+			slot.control = nullptr;
+		}
+		// Handles from before init() must not match a reused slot.
+		if (++slot.generation == 0) {
+			slot.generation = 1;
+		}
+	}
+	const size_t slots = _config.slotHandles ? std::min<size_t>(jobCapacityLocked(), 0xFFFFu) : 0;
+	_handleSlots.resize(slots);
+	_freeHandleSlots.clear();
+	_freeHandleSlots.reserve(slots);
+	for (size_t i = slots; i > 0; --i) {
+		_freeHandleSlots.push_back(static_cast<uint16_t>(i - 1));
 	}
+	for (auto &control : _activeControls) {
+		if (control && control->tracked) {
+			claimHandleSlotLocked(*control);
+		}
+	}
+}
 
-	return diag;
+void ESPWorker::claimHandleSlotLocked(WorkerHandler::Impl &control) {
+	if (_freeHandleSlots.empty() || control.detached || control.handleSlot >= 0) {
+		return;
+	}
+	const uint16_t index = _freeHandleSlots.back();
+	_freeHandleSlots.pop_back();
+	_handleSlots[index].control = &control;
+	control.handleSlot = index;
+}
+
+void ESPWorker::releaseHandleSlotLocked(WorkerHandler::Impl &control) {
+	if (control.handleSlot < 0) {
+		return;
+	}
+	HandleSlot &slot = _handleSlots[control.handleSlot];
+	slot.control = nullptr;
+	if (++slot.generation == 0) {
+		slot.generation = 1;
+	}
+	_freeHandleSlots.push_back(static_cast<uint16_t>(control.handleSlot));
+	control.handleSlot = -1;
+}
+
+WorkerSlotHandle ESPWorker::slotHandleLocked(const WorkerHandler::Impl &control) const {
+	if (control.handleSlot < 0) {
+		return {};
+	}
+	const uint16_t index = static_cast<uint16_t>(control.handleSlot);
+	return {index, _handleSlots[index].generation};
+}
+
+ESPWorker::JobRef ESPWorker::slotJob(WorkerSlotHandle handle, bool *stale) const {
+	std::lock_guard<std::mutex> guard(_mutex);
+	*stale = false;
+	if (handle.generation == 0 || handle.index >= _handleSlots.size()) {
+		return {};
+	}
+	const HandleSlot &slot = _handleSlots[handle.index];
+	if (slot.generation != handle.generation || !slot.control) {
+		*stale = true;
+		return {};
+	}
+	// Slots only name tracked jobs, which _activeControls still references.
+	return JobRef(slot.control);
+}
+
+bool ESPWorker::wait(WorkerSlotHandle handle, TickType_t ticks) {
+	bool stale = false;
+	JobRef control = slotJob(handle, &stale);
+	if (!control) {
+		return stale;
+	}
+	return WorkerHandler(std::move(control)).wait(ticks);
+}
+
+bool ESPWorker::destroy(WorkerSlotHandle handle) {
+	bool stale = false;
+	JobRef control = slotJob(handle, &stale);
+	return control && destroyWorker(control);
+}
+
+bool ESPWorker::getDiag(WorkerSlotHandle handle, JobDiag *out) const {
+	bool stale = false;
+	JobRef control = slotJob(handle, &stale);
+	if (!control || !out) {
+		return false;
+	}
+	*out = WorkerHandler(std::move(control)).getDiag();
+	return true;
+}
+
+bool ESPWorker::eraseControlLocked(const WorkerHandler::Impl *control) {
+	auto it = std::find_if(_activeControls.begin(), _activeControls.end(), [&](const auto &ptr) {
+		return ptr.get() == control;
+	});
+	if (it == _activeControls.end()) {
+		return false;
+	}
+	JobRef erased = std::move(*it);
+	_activeControls.erase(it);
+	if (erased) {
+		untrackControlLocked(*erased);
+	}
+	if (erased && erased->queued) {
+		erased->queued = false;
+		_deferredControls.erase(
+		    std::remove(_deferredControls.begin(), _deferredControls.end(), erased),
+		    _deferredControls.end()
+		);
+	}
+	if (erased && erased->waitingForWorker) {
+		erased->waitingForWorker = false;
+		_poolQueue.erase(
+		    std::remove(_poolQueue.begin(), _poolQueue.end(), erased), _poolQueue.end()
+		);
+	}
+	return true;
+}
+
+void ESPWorker::publishDiagLocked() {
+	uint32_t next = _diagVersion.load(std::memory_order_relaxed) + 1;
+	DiagSnapshot &snapshot = _diagSnapshots[next & 1u];
+	// Pairs with the acquire fence in getDiag(): a reader that observes any of these stores
+	// also observes the previous version bump and retries.
+	std::atomic_thread_fence(std::memory_order_release);
+	snapshot.totalJobs.store(_diagTotals.totalJobs, std::memory_order_relaxed);
+	snapshot.runningJobs.store(_diagTotals.runningJobs, std::memory_order_relaxed);
+	snapshot.psramStackJobs.store(_diagTotals.psramStackJobs, std::memory_order_relaxed);
+	snapshot.deferredJobs.store(_diagTotals.deferredJobs, std::memory_order_relaxed);
+	snapshot.startTickSum.store(_diagTotals.startTickSum, std::memory_order_relaxed);
+	snapshot.oldestStartTick.store(_diagTotals.oldestStartTick, std::memory_order_relaxed);
+	snapshot.poolWorkers.store(_diagTotals.poolWorkers, std::memory_order_relaxed);
+	snapshot.idleWorkers.store(_diagTotals.idleWorkers, std::memory_order_relaxed);
+	snapshot.poolGrows.store(_diagTotals.poolGrows, std::memory_order_relaxed);
+	snapshot.poolShrinks.store(_diagTotals.poolShrinks, std::memory_order_relaxed);
+	_diagVersion.store(next, std::memory_order_release);
+}
+
+// Core load is one minus the idle task's share of the run-time clock since the window began.
+// Callers that find another sample in progress, or a window shorter than kCoreLoadWindowUs,
+// keep the previous percentages.
+void ESPWorker::sampleCoreLoad(bool restart) const {
+#if ESPWORKER_CAN_SAMPLE_CORE_LOAD
+	if (_loadSample.sampling.exchange(true, std::memory_order_acquire)) {
+		return;
+	}
+	const uint32_t totalRunTime = static_cast<uint32_t>(portGET_RUN_TIME_COUNTER_VALUE());
+	const uint32_t elapsed = totalRunTime - _loadSample.totalRunTime;
+	if (restart || elapsed >= kCoreLoadWindowUs) {
+		for (size_t core = 0; core < kESPWorkerCoreCount; ++core) {
+			const uint32_t idleRunTime =
+			    taskRunTime(xTaskGetIdleTaskHandleForCore(static_cast<BaseType_t>(core)));
+			const uint32_t idle = idleRunTime - _loadSample.idleRunTime[core];
+			uint8_t percent = 0;
+			if (!restart && idle < elapsed) {
+				percent = static_cast<uint8_t>(
+				    100 - static_cast<uint64_t>(idle) * 100 / elapsed
+				);
+			}
+			_loadSample.idleRunTime[core] = idleRunTime;
+			_loadSample.coreLoadPercent[core].store(percent, std::memory_order_relaxed);
+		}
+		_loadSample.totalRunTime = totalRunTime;
+	}
+	_loadSample.sampling.store(false, std::memory_order_release);
+#else
+	(void)restart;
+#endif
+}
+
+WorkerCounters ESPWorker::getCounters() const {
+	WorkerCounters counters{};
+	counters.spawned = _counters.spawned.load(std::memory_order_relaxed);
+	counters.started = _counters.started.load(std::memory_order_relaxed);
+	counters.completed = _counters.completed.load(std::memory_order_relaxed);
+	counters.destroyed = _counters.destroyed.load(std::memory_order_relaxed);
+	counters.deferred = _counters.deferred.load(std::memory_order_relaxed);
+	counters.externalFallbacks = _counters.externalFallbacks.load(std::memory_order_relaxed);
+	counters.isrSubmitted = _counters.isrSubmitted.load(std::memory_order_relaxed);
+	counters.isrCompleted = _counters.isrCompleted.load(std::memory_order_relaxed);
+	counters.timedOut = _counters.timedOut.load(std::memory_order_relaxed);
+	counters.retries = _counters.retries.load(std::memory_order_relaxed);
+	counters.coalesced = _counters.coalesced.load(std::memory_order_relaxed);
+	counters.inlined = _counters.inlined.load(std::memory_order_relaxed);
+	counters.spinWaits = _counters.spinWaits.load(std::memory_order_relaxed);
+	counters.spinJoins = _counters.spinJoins.load(std::memory_order_relaxed);
+	for (size_t i = 0; i < kESPWorkerErrorCount; ++i) {
+		counters.errors[i] = _counters.errors[i].load(std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < kESPWorkerCoreCount; ++i) {
+		counters.busyTimeMs[i] = _counters.busyTimeMs[i].load(std::memory_order_relaxed);
+		counters.cpuTimeUs[i] = _counters.cpuTimeUs[i].load(std::memory_order_relaxed);
+	}
+	return counters;
+}
+
+void ESPWorker::resetCounters() {
+	_counters.spawned.store(0, std::memory_order_relaxed);
+	_counters.started.store(0, std::memory_order_relaxed);
+	_counters.completed.store(0, std::memory_order_relaxed);
+	_counters.destroyed.store(0, std::memory_order_relaxed);
+	_counters.deferred.store(0, std::memory_order_relaxed);
+	_counters.externalFallbacks.store(0, std::memory_order_relaxed);
+	_counters.isrSubmitted.store(0, std::memory_order_relaxed);
+	_counters.isrCompleted.store(0, std::memory_order_relaxed);
+	_counters.timedOut.store(0, std::memory_order_relaxed);
+	_counters.retries.store(0, std::memory_order_relaxed);
+	_counters.coalesced.store(0, std::memory_order_relaxed);
+	_counters.inlined.store(0, std::memory_order_relaxed);
+	_counters.spinWaits.store(0, std::memory_order_relaxed);
+	_counters.spinJoins.store(0, std::memory_order_relaxed);
+	for (auto &counter : _counters.errors) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+	for (auto &counter : _counters.busyTimeMs) {
+		counter.store(0, std::memory_order_relaxed);
+	}
+	for (auto &counter : _counters.cpuTimeUs) {
+		counter.store(0, std::memory_order_relaxed);
+	}
 }
 
 void ESPWorker::onEvent(EventCallback callback) {
 	std::lock_guard<std::mutex> guard(_callbackMutex);
-	_eventCallback = std::move(callback);
+	_eventCallback =
+	    callback ? std::make_shared<const EventCallback>(std::move(callback)) : nullptr;
 }
 
 void ESPWorker::onError(ErrorCallback callback) {
 	std::lock_guard<std::mutex> guard(_callbackMutex);
-	_errorCallback = std::move(callback);
+	_errorCallback =
+	    callback ? std::make_shared<const ErrorCallback>(std::move(callback)) : nullptr;
 }
 
 const char *ESPWorker::eventToString(WorkerEvent event) const {
@@ -572,6 +3709,8 @@ const char *ESPWorker::eventToString(WorkerEvent event) const {
 		return "Completed";
 	case WorkerEvent::Destroyed:
 		return "Destroyed";
+	case WorkerEvent::TimedOut:
+		return "TimedOut";
 	default:
 		return "Unknown";
 	}
@@ -593,27 +3732,31 @@ const char *ESPWorker::errorToString(WorkerError error) const {
 		return "NoMemory";
 	case WorkerError::ExternalStackUnsupported:
 		return "ExternalStackUnsupported";
+	case WorkerError::InsufficientMemory:
+		return "InsufficientMemory";
 	default:
 		return "Unknown";
 	}
 }
 
-std::string ESPWorker::makeName() {
-	static std::atomic<uint32_t> counter{0};
-	uint32_t id = counter.fetch_add(1, std::memory_order_relaxed);
-	char buffer[24];
-	snprintf(buffer, sizeof(buffer), "worker-%u", id);
-	return std::string(buffer);
+WorkerName ESPWorker::makeName() {
+	uint32_t id = _nameCounter.fetch_add(1, std::memory_order_relaxed);
+	char buffer[kESPWorkerNameCapacity];
+	snprintf(buffer, sizeof(buffer), "worker-%u", static_cast<unsigned>(id));
+	return WorkerName(buffer);
 }
 
-void ESPWorker::notifyEvent(WorkerEvent event) {
-	EventCallback callback;
+void ESPWorker::notifyEvent(WorkerEvent event, size_t count) {
+	std::shared_ptr<const EventCallback> callback;
 	{
 		std::lock_guard<std::mutex> guard(_callbackMutex);
 		callback = _eventCallback;
 	}
-	if (callback) {
-		invokeWorkerCallback(callback, event);
+	if (!callback) {
+		return;
+	}
+	for (size_t i = 0; i < count; ++i) {
+		invokeWorkerCallback(*callback, event);
 	}
 }
 
@@ -621,12 +3764,16 @@ void ESPWorker::notifyError(WorkerError error) {
 	if (error == WorkerError::None) {
 		return;
 	}
-	ErrorCallback callback;
+	size_t index = static_cast<size_t>(error);
+	if (index < kESPWorkerErrorCount) {
+		_counters.errors[index].fetch_add(1, std::memory_order_relaxed);
+	}
+	std::shared_ptr<const ErrorCallback> callback;
 	{
 		std::lock_guard<std::mutex> guard(_callbackMutex);
 		callback = _errorCallback;
 	}
 	if (callback) {
-		invokeWorkerCallback(callback, error);
+		invokeWorkerCallback(*callback, error);
 	}
 }
@@ -3,29 +3,147 @@
 #include <Arduino.h>
 
 #include <atomic>
+#include <cstddef>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 extern "C" {
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 }
 
 class WorkerHandler;
 class ESPWorker;
+class WorkerMailboxBase;
+template <typename Msg> class WorkerActor;
 
 constexpr size_t kESPWorkerDefaultStackSizeBytes = 4096;
+constexpr size_t kESPWorkerMaxBatchSize = 32;
+constexpr size_t kESPWorkerMaxMailboxCapacity = 1024;
+constexpr size_t kESPWorkerTagCount = 16; // WorkerConfig::tag values; 0 means untagged
+// Upper bounds of the per-name runtime histogram buckets; longer runs land in the +Inf bucket.
+constexpr size_t kESPWorkerRuntimeBucketCount = 5;
+constexpr uint32_t kESPWorkerRuntimeBucketMs[kESPWorkerRuntimeBucketCount] =
+    {1, 10, 100, 1000, 10000};
+#if defined(portNUM_PROCESSORS)
+constexpr size_t kESPWorkerCoreCount = portNUM_PROCESSORS;
+#else
+constexpr size_t kESPWorkerCoreCount = 1;
+#endif
+#if defined(configMAX_TASK_NAME_LEN)
+constexpr size_t kESPWorkerNameCapacity = configMAX_TASK_NAME_LEN; // including the terminator
+#else
+constexpr size_t kESPWorkerNameCapacity = 16;
+#endif
+
+// Fixed-capacity task name stored inline. Longer names are truncated the same way FreeRTOS
+// truncates task names, so copying a WorkerConfig never touches the heap.
+class WorkerName {
+  public:
+	WorkerName() = default;
+	WorkerName(const char *name) {
+		assign(name);
+	}
+	WorkerName(const std::string &name) {
+		assign(name.c_str());
+	}
+
+	WorkerName &operator=(const char *name) {
+		assign(name);
+		return *this;
+	}
+	WorkerName &operator=(const std::string &name) {
+		assign(name.c_str());
+		return *this;
+	}
+
+	void assign(const char *name) {
+		size_t length = name ? strnlen(name, kESPWorkerNameCapacity - 1) : 0;
+		if (length > 0) {
+			memcpy(_data, name, length);
+		}
+		_data[length] = '\0';
+	}
+
+	const char *c_str() const {
+		return _data;
+	}
+	size_t size() const {
+		return strnlen(_data, kESPWorkerNameCapacity);
+	}
+	bool empty() const {
+		return _data[0] == '\0';
+	}
+
+	bool operator==(const WorkerName &other) const {
+		return strncmp(_data, other._data, kESPWorkerNameCapacity) == 0;
+	}
+	bool operator!=(const WorkerName &other) const {
+		return !(*this == other);
+	}
+
+  private:
+	char _data[kESPWorkerNameCapacity] = {};
+};
+
+// What the supervisor does once a job outlives WorkerConfig::timeoutMs. WorkerEvent::TimedOut
+// is raised in every case.
+enum class WorkerTimeoutPolicy {
+	Report = 0,  // only count and report the timeout
+	RequestStop, // set the job's stop flag (see ESPWorker::stopRequested())
+	Destroy,     // delete the job's task like WorkerHandler::destroy()
+};
+
+// Backoff for WorkerConfig::retry. Attempt n + 1 starts min(baseDelayMs * multiplier^(n - 1),
+// maxDelayMs) after attempt n failed, spread by up to +/- jitterPercent.
+struct WorkerRetryPolicy {
+	uint8_t maxAttempts = 1; // total attempts including the first; 1 disables retries
+	uint32_t baseDelayMs = 100;
+	float multiplier = 2.0f;
+	uint32_t maxDelayMs = 30000;
+	uint8_t jitterPercent = 0;
+};
 
 struct WorkerConfig {
 	size_t stackSizeBytes = kESPWorkerDefaultStackSizeBytes; // Task stack size in bytes
 	UBaseType_t priority = 1;                                // FreeRTOS task priority
 	BaseType_t coreId = tskNO_AFFINITY; // preferred core, or tskNO_AFFINITY for any
-	std::string name{};                 // optional task name
+	WorkerName name{};                  // optional task name
 	bool useExternalStack = false;      // request PSRAM backed stack for the task
+	uint32_t timeoutMs = 0;             // supervisor deadline counted from job start; 0 disables
+	WorkerTimeoutPolicy timeoutPolicy = WorkerTimeoutPolicy::RequestStop;
+	WorkerRetryPolicy retry{}; // re-run failed or timed-out jobs and failed task creation
+	bool trackHeap = false;    // record free-heap deltas and counted allocations (JobDiag)
+	uint8_t tag = 0;           // group for destroyTag()/waitTag(), below kESPWorkerTagCount
+	// Non-zero: a spawn while a job with the same key is unfinished merges into that job instead
+	// of starting another (see WorkerResult::existing).
+	uint32_t coalesceKey = 0;
+	bool coalesceLatestWins = false; // a merged submission replaces the callback still pending
+	// Non-zero: spawn() runs a named job on the calling task, without a task handoff, when the
+	// name's learned CPU time (WorkerNameStats::cpuTimeUsEwma) is below this many microseconds.
+	// Jobs with a Destroy timeout and debounced callbacks always get a task. Needs
+	// configGENERATE_RUN_TIME_STATS; ignored otherwise.
+	uint32_t inlineIfCheaperThanUs = 0;
+};
+
+// How the memory governor let a job in (see ESPWorker::Config::memoryPolicy).
+enum class WorkerAdmission {
+	Immediate = 0,    // created with the stack it asked for
+	Deferred,         // queued until enough internal RAM was free
+	ExternalFallback, // moved to a PSRAM stack because internal RAM was low
+};
+
+enum class WorkerMemoryPolicy {
+	Reject = 0,    // fail the spawn with WorkerError::InsufficientMemory
+	Queue,         // hold the job until a finishing worker leaves enough headroom
+	ExternalStack, // place the stack in PSRAM when the PSRAM reserve allows it
 };
 
 struct JobDiag {
@@ -34,6 +152,30 @@ struct JobDiag {
 	bool running = false;
 	bool destroyed = false;
 	TaskHandle_t taskHandle = nullptr;
+	WorkerAdmission admission = WorkerAdmission::Immediate;
+	bool queued = false; // still waiting in the admission queue
+	bool pooled = false; // runs on an elastic pool task instead of a dedicated one
+	bool timedOut = false;      // outlived config.timeoutMs
+	bool stopRequested = false; // requestStop() or the timeout policy asked the job to return
+	uint8_t attempts = 0;       // launches so far, including retries
+	bool failed = false;        // ESPWorker::reportFailure() was called during the last attempt
+	bool retryPending = false;  // waiting out a backoff delay; holds no task or stack
+	// CPU time the callback spent scheduled, summed over finished attempts. Needs
+	// configGENERATE_RUN_TIME_STATS; zero otherwise.
+	uint32_t cpuTimeUs = 0;
+	// With WorkerConfig::trackHeap: free heap lost between callback start and return, summed
+	// over attempts (positive means the job kept memory), and the allocations reported through
+	// ESPWorker::countAllocation(). Other tasks allocating meanwhile show up in the deltas too.
+	int32_t internalHeapDelta = 0;
+	int32_t psramHeapDelta = 0;
+	uint32_t heapAllocations = 0;
+	uint32_t coalesced = 0; // submissions merged into this job through WorkerConfig::coalesceKey
+	bool ranInline = false; // ran on the spawning task (WorkerConfig::inlineIfCheaperThanUs)
+	// Actor mailbox statistics; zero for plain jobs.
+	size_t mailboxCapacity = 0;
+	size_t mailboxDepth = 0;
+	uint32_t mailboxDelivered = 0;
+	uint32_t mailboxDropped = 0;
 };
 
 struct WorkerDiag {
@@ -41,8 +183,16 @@ struct WorkerDiag {
 	size_t runningJobs = 0;
 	size_t waitingJobs = 0;
 	size_t psramStackJobs = 0;
+	size_t deferredJobs = 0; // waiting in the admission queue (included in waitingJobs)
 	uint32_t averageRuntimeMs = 0;
 	uint32_t maxRuntimeMs = 0;
+	size_t poolWorkers = 0;   // elastic pool tasks alive
+	size_t idleWorkers = 0;   // pool tasks waiting for a job
+	uint32_t poolGrows = 0;   // pool tasks started since init()
+	uint32_t poolShrinks = 0; // pool tasks that exited after idleTimeoutMs
+	// Share of each core not spent in its idle task, over a window of at least one second that
+	// getDiag() calls advance. Needs configGENERATE_RUN_TIME_STATS; zero otherwise.
+	uint8_t coreLoadPercent[kESPWorkerCoreCount] = {};
 };
 
 enum class WorkerError {
@@ -53,6 +203,35 @@ enum class WorkerError {
 	TaskCreateFailed,
 	NoMemory,
 	ExternalStackUnsupported,
+	InsufficientMemory,
+};
+
+constexpr size_t kESPWorkerErrorCount = static_cast<size_t>(WorkerError::InsufficientMemory) + 1;
+
+// Monotonic lifetime counters since init(). Values wrap at 2^32; compute deltas between polls.
+struct WorkerCounters {
+	uint32_t spawned = 0;
+	uint32_t started = 0;
+	uint32_t completed = 0;
+	uint32_t destroyed = 0;
+	uint32_t deferred = 0;          // jobs the memory governor queued
+	uint32_t externalFallbacks = 0; // jobs the memory governor moved to PSRAM stacks
+	uint32_t isrSubmitted = 0;      // callbacks accepted by submitFromISR()
+	uint32_t isrCompleted = 0;      // submitFromISR() callbacks that ran on a pool task
+	uint32_t timedOut = 0;          // jobs that outlived WorkerConfig::timeoutMs
+	uint32_t retries = 0;           // attempts scheduled by WorkerConfig::retry
+	uint32_t coalesced = 0;         // spawns merged into an unfinished job with the same key
+	uint32_t inlined = 0;           // jobs run on the spawning task instead of a worker task
+	uint32_t spinWaits = 0;         // wait() calls that polled the job before blocking
+	uint32_t spinJoins = 0;         // of those, the ones that saw the job finish while polling
+	uint32_t errors[kESPWorkerErrorCount] = {};    // indexed by WorkerError
+	uint32_t busyTimeMs[kESPWorkerCoreCount] = {}; // job runtime accumulated per core
+	uint32_t cpuTimeUs[kESPWorkerCoreCount] = {};  // job CPU time per core (run-time stats)
+
+	uint32_t errorCount(WorkerError error) const {
+		size_t index = static_cast<size_t>(error);
+		return index < kESPWorkerErrorCount ? errors[index] : 0;
+	}
 };
 
 enum class WorkerEvent {
@@ -60,8 +239,107 @@ enum class WorkerEvent {
 	Started,
 	Completed,
 	Destroyed,
+	TimedOut,
+};
+
+// One WorkerConfig::tag, from ESPWorker::getDiag(tag).
+struct WorkerTagDiag {
+	size_t jobs = 0;        // tracked jobs carrying the tag
+	size_t runningJobs = 0; // jobs on a task
+	size_t waitingJobs = 0; // queued for memory or a pool task, or backing off before a retry
+	uint32_t maxRuntimeMs = 0;
+	uint32_t spawned = 0; // lifetime totals since init()
+	uint32_t completed = 0;
+	uint32_t destroyed = 0;
+};
+
+// Aggregates for jobs spawned with an explicit WorkerConfig::name; see ESPWorker::getNameStats().
+struct WorkerNameStats {
+	WorkerName name{};
+	uint32_t timeouts = 0;
+	uint32_t finished = 0; // completed or destroyed jobs
+	uint64_t runtimeMsSum = 0;
+	uint64_t cpuTimeUsSum = 0; // see JobDiag::cpuTimeUs
+	uint32_t completed = 0;     // finished jobs whose callback returned
+	uint32_t cpuTimeUsEwma = 0; // moving average (weight 1/4) of completed jobs' CPU time
+	// Sums of the JobDiag heap fields over finished jobs with WorkerConfig::trackHeap.
+	int64_t internalHeapDeltaSum = 0;
+	int64_t psramHeapDeltaSum = 0;
+	uint32_t heapAllocations = 0;
+	// Finished jobs per kESPWorkerRuntimeBucketMs bucket (not cumulative); the last is +Inf.
+	uint32_t runtimeBuckets[kESPWorkerRuntimeBucketCount + 1] = {};
+};
+
+// How ESPWorker::spawnDebounced()/spawnThrottled() treat a key.
+enum class WorkerRateMode : uint8_t {
+	Debounce, // spawn the latest callback once the key has been quiet for the window
+	Throttle, // spawn at most once per interval and drop callbacks in between
 };
 
+// Per-key statistics of the rate-limit table; see ESPWorker::getRateStats().
+struct WorkerRateStats {
+	uint32_t key = 0;
+	WorkerRateMode mode = WorkerRateMode::Debounce;
+	uint32_t accepted = 0;   // jobs spawned for the key
+	uint32_t suppressed = 0; // callbacks dropped (Throttle) or superseded (Debounce)
+	bool pending = false;    // a debounced callback is waiting for its window to pass
+};
+
+// Owning pointer over an intrusive count, in the manner of boost::intrusive_ptr: the pointee
+// type provides workerRefRetain()/workerRefRelease(), found by argument-dependent lookup.
+template <typename T> class WorkerRef {
+  public:
+	WorkerRef() = default;
+	WorkerRef(std::nullptr_t) {
+	}
+	explicit WorkerRef(T *object) : _object(object) {
+		if (_object) {
+			workerRefRetain(_object);
+		}
+	}
+	WorkerRef(const WorkerRef &other) : WorkerRef(other._object) {
+	}
+	WorkerRef(WorkerRef &&other) noexcept : _object(other._object) {
+		other._object = nullptr;
+	}
+	WorkerRef &operator=(WorkerRef other) noexcept {
+		std::swap(_object, other._object);
+		return *this;
+	}
+	~WorkerRef() {
+		if (_object) {
+			workerRefRelease(_object);
+		}
+	}
+
+	T *get() const {
+		return _object;
+	}
+	T *operator->() const {
+		return _object;
+	}
+	T &operator*() const {
+		return *_object;
+	}
+	explicit operator bool() const {
+		return _object != nullptr;
+	}
+	void reset() {
+		*this = WorkerRef();
+	}
+	friend bool operator==(const WorkerRef &a, const WorkerRef &b) {
+		return a._object == b._object;
+	}
+	friend bool operator!=(const WorkerRef &a, const WorkerRef &b) {
+		return a._object != b._object;
+	}
+
+  private:
+	T *_object = nullptr;
+};
+
+// Value handle to one job. Copies share the job through a single intrusive count kept in the
+// job's control state, so copying costs one atomic increment and calls reach the job directly.
 class WorkerHandler {
   public:
 	WorkerHandler() = default;
@@ -70,32 +348,143 @@ class WorkerHandler {
 	JobDiag getDiag() const;
 	bool wait(TickType_t ticks = portMAX_DELAY);
 	bool destroy();
+	// Cooperative cancellation: the job sees it through ESPWorker::stopRequested().
+	void requestStop();
+	bool stopRequested() const;
+
+	bool operator==(const WorkerHandler &other) const {
+		return _control == other._control;
+	}
+	bool operator!=(const WorkerHandler &other) const {
+		return _control != other._control;
+	}
 
   private:
 	struct Impl;
 	friend class ESPWorker;
-	explicit WorkerHandler(std::shared_ptr<Impl> control);
+	friend void workerRefRetain(Impl *control);
+	friend void workerRefRelease(Impl *control);
+	explicit WorkerHandler(WorkerRef<Impl> control);
 
-	std::shared_ptr<Impl> _control{};
+	WorkerRef<Impl> _control{};
+};
+
+// Reference to a job in the fixed table reserved with ESPWorker::Config::slotHandles: a 16-bit
+// slot index and the slot's 16-bit generation, which changes whenever the slot is reused.
+// Trivially copyable and packs into a uint32_t, so it can go through FreeRTOS queues and ISRs.
+struct WorkerSlotHandle {
+	uint16_t index = 0;
+	uint16_t generation = 0; // 0 never names a job
+
+	bool valid() const {
+		return generation != 0;
+	}
+	uint32_t raw() const {
+		return (static_cast<uint32_t>(generation) << 16) | index;
+	}
+	static WorkerSlotHandle fromRaw(uint32_t raw) {
+		return {static_cast<uint16_t>(raw & 0xFFFFu), static_cast<uint16_t>(raw >> 16)};
+	}
+	bool operator==(const WorkerSlotHandle &other) const {
+		return index == other.index && generation == other.generation;
+	}
+	bool operator!=(const WorkerSlotHandle &other) const {
+		return !(*this == other);
+	}
 };
 
 struct WorkerResult {
 	WorkerError error{WorkerError::None};
+	// Shared handler kept for existing callers; handle below refers to the same job without the
+	// extra shared_ptr layer.
 	std::shared_ptr<WorkerHandler> handler{};
 	const char *message{nullptr};
+	// spawnUnique() or WorkerConfig::coalesceKey returned an unfinished job and spawned nothing.
+	bool existing{false};
+	bool suppressed{false}; // spawnThrottled() dropped the callback inside the interval
+	WorkerHandler handle{};
+	WorkerSlotHandle slot{}; // with ESPWorker::Config::slotHandles
+
+	explicit operator bool() const {
+		return error == WorkerError::None;
+	}
+};
+
+// Returned by ESPWorker::submitFromISR(); pass yieldRequired on to portYIELD_FROM_ISR().
+struct WorkerIsrResult {
+	WorkerError error{WorkerError::None};
+	BaseType_t yieldRequired{pdFALSE};
+
+	explicit operator bool() const {
+		return error == WorkerError::None;
+	}
+};
+
+enum class WorkerBatchPolicy {
+	AllOrNothing = 0, // reject the batch unless every job gets a slot
+	Partial,          // spawn as many jobs as there are free slots (see spawned)
+};
+
+// Compact handle for jobs submitted together through ESPWorker::spawnBatch().
+class WorkerBatch {
+  public:
+	WorkerBatch() = default;
+
+	bool valid() const;
+	size_t size() const;      // jobs spawned by the batch
+	size_t remaining() const; // jobs that have not finished yet
+	bool waitAll(TickType_t ticks = portMAX_DELAY);
+
+  private:
+	struct Impl;
+	friend class ESPWorker;
+	friend class WorkerHandler;
+	explicit WorkerBatch(std::shared_ptr<Impl> state);
+
+	std::shared_ptr<Impl> _state{};
+};
+
+struct WorkerBatchResult {
+	WorkerError error{WorkerError::None};
+	WorkerBatch batch{};
+	size_t spawned{0};
+	const char *message{nullptr};
 
 	explicit operator bool() const {
 		return error == WorkerError::None;
 	}
 };
 
+// Serial executor from ESPWorker::strand(). Posted jobs run one at a time in FIFO order on
+// whichever worker task drains the strand; copies of the handle share the same queue.
+class WorkerStrand {
+  public:
+	WorkerStrand() = default;
+
+	bool valid() const;
+	const char *name() const;
+	size_t pending() const; // posted jobs that have not finished
+	// A queued job is never dropped: if the drain job cannot be started, post() still returns
+	// None, onError() reports the spawn failure, and the job runs with the next post's drain.
+	WorkerError post(std::function<void()> callback);
+
+  private:
+	struct Impl;
+	friend class ESPWorker;
+	explicit WorkerStrand(std::shared_ptr<Impl> state);
+
+	std::shared_ptr<Impl> _state{};
+};
+
 class ESPWorker {
 	friend class WorkerHandler;
+	friend class WorkerStrand;
 
   public:
 	using TaskCallback = std::function<void()>;
 	using EventCallback = std::function<void(WorkerEvent)>;
 	using ErrorCallback = std::function<void(WorkerError)>;
+	using IsrCallback = void (*)(void *arg);
 
 	struct Config {
 		size_t maxWorkers = 8;
@@ -103,12 +492,56 @@ class ESPWorker {
 		UBaseType_t priority = 1;
 		BaseType_t coreId = tskNO_AFFINITY;
 		bool enableExternalStacks = true;
+		// Static allocation mode: tasks are created with xTaskCreateStaticPinnedToCore from a
+		// table of maxWorkers TCBs and stackSizeBytes stacks reserved once by init(). Pass your
+		// own buffers to keep the heap untouched, otherwise init() allocates them. Job and batch
+		// state come from an arena of 2 * maxWorkers blocks reserved alongside. A handler kept
+		// after its job finished holds its block, so once every block is held spawns fail with
+		// NoMemory until handlers are dropped. strand() and spawnActor() need the heap and fail
+		// with InvalidConfig in this mode.
+		bool staticAllocation = false;
+		StaticTask_t *staticTaskBuffers = nullptr; // maxWorkers entries
+		StackType_t *staticStackBuffer = nullptr;  // maxWorkers * stackSizeBytes bytes
+		// Memory governor: checked against heap_caps_get_free_size() and
+		// heap_caps_get_largest_free_block() before a heap-allocated stack is created. A zero
+		// threshold is not enforced; static allocation mode skips the governor.
+		size_t minFreeInternalBytes = 0;    // internal RAM left free after the stack is allocated
+		size_t minLargestInternalBlock = 0; // largest free internal block required to admit a job
+		size_t psramReserveBytes = 0;       // PSRAM left free after a PSRAM stack is allocated
+		WorkerMemoryPolicy memoryPolicy = WorkerMemoryPolicy::Reject;
+		size_t admissionQueueDepth = 4; // jobs WorkerMemoryPolicy::Queue may hold
+		// Elastic pool: jobs that fit stackSizeBytes and coreId and use an internal stack run on
+		// pooled tasks. The pool keeps minWorkers tasks, starts another (up to maxWorkers) only
+		// when queued jobs outnumber idle tasks, and a task idle for idleTimeoutMs exits. The
+		// memory governor gates pool growth. Ignored in static allocation mode.
+		bool elasticPool = false;
+		size_t minWorkers = 0;
+		uint32_t idleTimeoutMs = 5000; // 0 keeps idle pool tasks forever
+		size_t poolQueueDepth = 16;    // pooled jobs that may wait on top of maxWorkers running
+		// ISR submission: init() reserves a ring of isrQueueDepth entries (rounded up to a power
+		// of two) for submitFromISR(). Needs elasticPool; keep minWorkers > 0 so a parked pool
+		// task is always there to wake. 0 disables submitFromISR().
+		size_t isrQueueDepth = 0;
+		size_t nameStatsCapacity = 16; // distinct job names getNameStats() keeps
+		// Hash index of explicitly named jobs for find() and spawnUnique(). init() reserves an
+		// open-addressing table at most half full, so lookups stay short.
+		bool indexNames = false;
+		size_t rateLimitKeys = 0; // keys spawnDebounced()/spawnThrottled() track; 0 disables them
+		// Reserve one generational slot per job the worker can hold and return a
+		// WorkerSlotHandle for every job that has a handler.
+		bool slotHandles = false;
+		// wait() polls a job running on another core for up to this many microseconds before
+		// it blocks. Named jobs with a learned CPU time (WorkerNameStats::cpuTimeUsEwma) poll
+		// for about twice that instead, and not at all when it exceeds the limit. 0 disables.
+		uint32_t maxSpinWaitUs = 0;
 	};
 
 	ESPWorker() = default;
 	~ESPWorker();
 
-	void init(const Config &config);
+	// Returns NoMemory or InvalidConfig when static allocation mode could not reserve its
+	// slots; the worker is initialized either way and static spawns then fail with that error.
+	WorkerError init(const Config &config);
 	void deinit();
 	bool isInitialized() const {
 		return _initialized.load(std::memory_order_acquire);
@@ -116,11 +549,121 @@ class ESPWorker {
 
 	WorkerResult spawn(TaskCallback callback, const WorkerConfig &config = WorkerConfig{});
 	WorkerResult spawnExt(TaskCallback callback, const WorkerConfig &config = WorkerConfig{});
+	// Fire-and-forget spawn: creates no WorkerHandler and nothing to wait on, and the job
+	// state is freed as soon as the job finishes. Detached jobs are invisible to find(),
+	// spawnUnique() and coalescing merges.
+	WorkerError spawnDetached(TaskCallback callback, const WorkerConfig &config = WorkerConfig{});
+
+	// Spawns up to kESPWorkerMaxBatchSize jobs sharing one config with a single validation and
+	// slot reservation. Callbacks are moved from; rejected ones are left in place.
+	WorkerBatchResult spawnBatch(
+	    TaskCallback *callbacks,
+	    size_t count,
+	    const WorkerConfig &config = WorkerConfig{},
+	    WorkerBatchPolicy policy = WorkerBatchPolicy::AllOrNothing
+	);
+	template <size_t N>
+	WorkerBatchResult spawnBatch(
+	    TaskCallback (&callbacks)[N],
+	    const WorkerConfig &config = WorkerConfig{},
+	    WorkerBatchPolicy policy = WorkerBatchPolicy::AllOrNothing
+	) {
+		return spawnBatch(callbacks, N, config, policy);
+	}
+
+	// Spawns a long-lived job that calls handler(Msg&&) for every message posted to its bounded
+	// mailbox (capacity rounded up to a power of two). Messages are moved, never copied, and the
+	// actor sleeps on its task notification while the mailbox is empty. Always gets a dedicated
+	// task. Defined in actor.h.
+	template <typename Msg, typename Handler>
+	WorkerActor<Msg>
+	spawnActor(Handler handler, size_t capacity, const WorkerConfig &config = WorkerConfig{});
+
+	// Queues callback(arg) on the elastic pool from an interrupt handler without locking or
+	// allocating, and wakes a parked pool task. When every pool task is busy the callback runs on
+	// the next one that finishes. No handler or events; failures are counted in getCounters()
+	// but not passed to onError(), which is not ISR-safe.
+	WorkerIsrResult submitFromISR(IsrCallback callback, void *arg);
+
+	// Creates a strand whose jobs never overlap and start in post order. Each time the strand
+	// goes from idle to busy it spawns one drain job (pooled when the elastic pool is enabled)
+	// named after the strand.
+	WorkerStrand strand(const char *name = nullptr);
+
+	// Handler of a job spawned with this name that has not finished yet, or nullptr. Needs
+	// Config::indexNames; names compare after truncation to kESPWorkerNameCapacity.
+	std::shared_ptr<WorkerHandler> find(const char *name);
+	// Single-flight spawn: when a job with this name has not finished, returns its handler with
+	// existing set instead of spawning. The check and the spawn happen under one lock. Needs
+	// Config::indexNames; name overrides config.name.
+	WorkerResult spawnUnique(
+	    const char *name, TaskCallback callback, const WorkerConfig &config = WorkerConfig{}
+	);
+
+	// Rate-limited spawns keyed by a caller-chosen 32-bit key. Keys live in a fixed table of
+	// Config::rateLimitKeys entries and are timed by the supervisor timer, so there is no task or
+	// timer per key. spawnDebounced() keeps the latest callback until the key has been quiet for
+	// windowMs and then spawns it, so it never returns a handler. spawnThrottled() spawns right
+	// away at most once per minIntervalMs and drops the callbacks in between (suppressed set).
+	// When the table is full, an idle key is evicted together with its statistics.
+	WorkerResult spawnDebounced(
+	    uint32_t key,
+	    uint32_t windowMs,
+	    TaskCallback callback,
+	    const WorkerConfig &config = WorkerConfig{}
+	);
+	WorkerResult spawnThrottled(
+	    uint32_t key,
+	    uint32_t minIntervalMs,
+	    TaskCallback callback,
+	    const WorkerConfig &config = WorkerConfig{}
+	);
+	// Copies up to capacity entries and returns how many were written.
+	size_t getRateStats(WorkerRateStats *out, size_t capacity) const;
+	WorkerRateStats getRateStats(uint32_t key) const; // zeroed when the key is unknown
+
+	// Table lookups for WorkerResult::slot. A handle whose generation no longer matches its
+	// slot belongs to a job that has finished: wait() returns true, destroy() and getDiag()
+	// return false. Handles that were never issued fail all three.
+	bool wait(WorkerSlotHandle handle, TickType_t ticks = portMAX_DELAY);
+	bool destroy(WorkerSlotHandle handle);
+	bool getDiag(WorkerSlotHandle handle, JobDiag *out) const;
 
 	size_t activeWorkers() const;
 	void cleanupFinished();
 
 	WorkerDiag getDiag() const;
+	WorkerCounters getCounters() const;
+
+	// Tagged jobs are kept on one intrusive list per tag, so these cost time proportional to the
+	// tag's own jobs. destroyTag() destroys every job of the tag except the calling one and
+	// returns how many it destroyed. waitTag() returns once the tag has no jobs left.
+	size_t destroyTag(uint8_t tag);
+	bool waitTag(uint8_t tag, TickType_t ticks = portMAX_DELAY);
+	WorkerTagDiag getDiag(uint8_t tag) const;
+	// Copies up to capacity entries and returns how many were written.
+	size_t getNameStats(WorkerNameStats *out, size_t capacity) const;
+	WorkerNameStats getNameStats(const char *name) const; // zeroed when the name is unknown
+
+	// OpenMetrics text exposition of the counters, the pool gauges and the per-name runtime
+	// histograms, ending in "# EOF". Formats one line at a time on the stack and never touches
+	// the heap. The buffer form always NUL-terminates and returns the full length, so a return
+	// value >= capacity means the output was truncated. Defined in metrics.cpp.
+	using MetricsSink = void (*)(const char *data, size_t length, void *context);
+	size_t writeMetrics(char *buffer, size_t capacity) const;
+	void streamMetrics(MetricsSink sink, void *context) const;
+
+	// True once the job running on the calling task was asked to stop, either through
+	// WorkerHandler::requestStop() or by WorkerTimeoutPolicy::RequestStop. Long-running loops
+	// should poll it and return.
+	static bool stopRequested();
+	// Marks the job running on the calling task as failed. When the callback returns, the job is
+	// retried according to WorkerConfig::retry, or completes with JobDiag::failed set.
+	static void reportFailure();
+	// Counts one allocation against the job on the calling task when it has
+	// WorkerConfig::trackHeap set. Call it from an allocation hook, such as
+	// esp_heap_trace_alloc_hook() with CONFIG_HEAP_USE_HOOKS or a replaced operator new.
+	static void countAllocation();
 
 	void onEvent(EventCallback callback);
 	void onError(ErrorCallback callback);
@@ -129,23 +672,301 @@ class ESPWorker {
 	const char *errorToString(WorkerError error) const;
 
   private:
-	WorkerResult spawnInternal(TaskCallback &&callback, WorkerConfig config);
+	using JobRef = WorkerRef<WorkerHandler::Impl>;
+
+	enum class SpawnMode : uint8_t {
+		Plain,
+		Unique,   // spawnUnique(): return the unfinished job with the same name instead
+		Detached, // spawnDetached(): no handler, nothing waits on the job
+		Timer,    // fired by the supervisor timer; never runs inline on the timer service task
+	};
+	WorkerResult spawnInternal(
+	    TaskCallback &&callback,
+	    const WorkerConfig &requested,
+	    std::shared_ptr<WorkerMailboxBase> mailbox = nullptr,
+	    SpawnMode mode = SpawnMode::Plain
+	);
+	struct RateSlot {
+		WorkerRateStats stats{};
+		bool used = false;
+		TickType_t interval = 0;
+		TickType_t tick = 0; // Throttle: last spawn; Debounce: when the callback is due
+		TaskCallback callback{};
+		WorkerConfig config{};
+	};
+	WorkerResult spawnRateLimited(
+	    WorkerRateMode mode,
+	    uint32_t key,
+	    uint32_t periodMs,
+	    TaskCallback &&callback,
+	    const WorkerConfig &config
+	);
+	RateSlot *
+	rateSlotLocked(uint32_t key, WorkerRateMode mode, WorkerError *error, const char **message);
+	// Takes back an accept whose spawn failed; a throttle window reopens at previousTick.
+	void
+	unacceptRateLocked(uint32_t key, WorkerRateMode mode, TickType_t tick, TickType_t previousTick);
+	WorkerResult spawnActorJob(
+	    TaskCallback &&callback,
+	    const WorkerConfig &config,
+	    std::shared_ptr<WorkerMailboxBase> mailbox
+	);
+	WorkerConfig resolveConfig(const WorkerConfig &config);
+	WorkerError validateConfig(const WorkerConfig &config, const char **message) const;
+	void admitLocked(const JobRef &control);
+	void releaseAdmissionLocked(WorkerHandler::Impl &control);
+	void abandonControl(const JobRef &control);
+	bool governorEnabled() const;
+	bool hasStackHeadroom(size_t stackBytes, bool external, size_t releasedBytes = 0) const;
+	WorkerError governAdmission(
+	    WorkerConfig &config, size_t jobs, WorkerAdmission *admission, const char **message
+	) const;
+	void admitDeferred(size_t releasedBytes, bool releasedExternal);
+	size_t jobCapacityLocked() const;
+	bool poolEligible(const WorkerConfig &config) const;
 	static void taskTrampoline(void *arg);
+	WorkerError postToStrand(const std::shared_ptr<WorkerStrand::Impl> &strand, TaskCallback &&cb);
+	void drainStrand(WorkerStrand::Impl &strand);
 
-	void runTask(std::shared_ptr<WorkerHandler::Impl> control);
-	void finalizeWorker(const std::shared_ptr<WorkerHandler::Impl> &control, bool destroyed);
-	bool destroyWorker(const std::shared_ptr<WorkerHandler::Impl> &control);
-	std::string makeName();
-	void notifyEvent(WorkerEvent event);
+	void runTask(JobRef control);
+	void finalizeWorker(const JobRef &control, bool destroyed);
+	bool destroyWorker(const JobRef &control);
+	bool waitCompletion(WorkerHandler::Impl &control, TickType_t ticks);
+	void completeLocked(WorkerHandler::Impl &control);
+	uint32_t spinBudgetLocked(const WorkerHandler::Impl &control) const;
+	WorkerName makeName();
+	void notifyEvent(WorkerEvent event, size_t count = 1);
 	void notifyError(WorkerError error);
+	void resetCounters();
+
+	void trackControlLocked(WorkerHandler::Impl &control);
+	void untrackControlLocked(WorkerHandler::Impl &control);
+	void trackRunningLocked(WorkerHandler::Impl &control);
+	void untrackRunningLocked(WorkerHandler::Impl &control);
+	void linkTagLocked(WorkerHandler::Impl &control);
+	void unlinkTagLocked(WorkerHandler::Impl &control);
+	void setupNameIndexLocked();
+	void indexNameLocked(WorkerHandler::Impl &control);
+	void unindexNameLocked(WorkerHandler::Impl &control);
+	WorkerHandler::Impl *findNamedLocked(const WorkerName &name, uint32_t hash) const;
+	std::shared_ptr<WorkerHandler> handlerFor(const JobRef &control);
+	WorkerResult existingResult(const JobRef &control); // spawnUnique()/coalescing found a job
+	void setupHandleSlotsLocked();
+	void claimHandleSlotLocked(WorkerHandler::Impl &control);
+	void releaseHandleSlotLocked(WorkerHandler::Impl &control);
+	WorkerSlotHandle slotHandleLocked(const WorkerHandler::Impl &control) const;
+	// Live job for handle, or nullptr with *stale telling whether the handle was ever issued.
+	JobRef slotJob(WorkerSlotHandle handle, bool *stale) const;
+	// Control state in internal RAM. With handler set, the same allocation also holds the
+	// shared WorkerHandler returned in WorkerResult::handler.
+	JobRef createControl(std::shared_ptr<WorkerHandler> *handler);
+	JobRef coalesceLocked(const WorkerConfig &config, TaskCallback &callback);
+	TaskCallback takeCallback(WorkerHandler::Impl &control);
+	bool takeFollowUp(WorkerHandler::Impl &control, TaskCallback &callback);
+	void invokeJob(WorkerHandler::Impl &control, const TaskCallback &callback);
+	bool inlineEligible(const WorkerConfig &config) const;
+	void promoteDeferredLocked(WorkerHandler::Impl &control);
+	bool eraseControlLocked(const WorkerHandler::Impl *control);
+	void publishDiagLocked();
+	void sampleCoreLoad(bool restart) const;
+
+	// NoMemory when FreeRTOS could not allocate the stack or TCB, TaskCreateFailed otherwise.
+	WorkerError createTask(WorkerHandler::Impl &control);
+	WorkerError setupStaticSlotsLocked();
+	void releaseStaticSlotsLocked();
+	bool acquireStaticSlotLocked(WorkerHandler::Impl &control); // sets control.staticSlot
+	void retireStaticSlot(int index);
+	void markStarted(WorkerHandler::Impl &control);
+
+	// Supervisor: one one-shot software timer armed for the earliest timeout, retry or debounce
+	// deadline.
+	bool ensureSupervisorLocked();
+	bool superviseLocked(WorkerHandler::Impl &control);
+	void armSupervisorLocked(TickType_t deadline);
+	static void supervisorTimerCallback(TimerHandle_t timer);
+	void superviseJobs();
+
+	bool scheduleRetryLocked(WorkerHandler::Impl &control);
+	TickType_t retryDelayLocked(const WorkerHandler::Impl &control);
+	bool retryAfterRun(const JobRef &control, TaskCallback &callback);
+	void retryLaunch(const JobRef &control, WorkerError error);
+	void relaunchJob(const JobRef &control);
+	WorkerNameStats *nameStatsLocked(const WorkerName &name);
+	const WorkerNameStats *findNameStatsLocked(const WorkerName &name) const;
+	bool nameStatsAt(size_t index, WorkerNameStats *out) const;
+
+	struct AtomicCounters {
+		std::atomic<uint32_t> spawned{0};
+		std::atomic<uint32_t> started{0};
+		std::atomic<uint32_t> completed{0};
+		std::atomic<uint32_t> destroyed{0};
+		std::atomic<uint32_t> deferred{0};
+		std::atomic<uint32_t> externalFallbacks{0};
+		std::atomic<uint32_t> isrSubmitted{0};
+		std::atomic<uint32_t> isrCompleted{0};
+		std::atomic<uint32_t> timedOut{0};
+		std::atomic<uint32_t> retries{0};
+		std::atomic<uint32_t> coalesced{0};
+		std::atomic<uint32_t> inlined{0};
+		std::atomic<uint32_t> spinWaits{0};
+		std::atomic<uint32_t> spinJoins{0};
+		std::atomic<uint32_t> errors[kESPWorkerErrorCount]{};
+		std::atomic<uint32_t> busyTimeMs[kESPWorkerCoreCount]{};
+		std::atomic<uint32_t> cpuTimeUs[kESPWorkerCoreCount]{};
+	};
+
+	// Aggregate diag state maintained by writers under _mutex.
+	struct DiagTotals {
+		uint32_t totalJobs = 0;
+		uint32_t runningJobs = 0;
+		uint32_t psramStackJobs = 0;
+		uint32_t deferredJobs = 0;
+		uint32_t startTickSum = 0; // modular sum of running jobs' start ticks
+		TickType_t oldestStartTick = 0;
+		uint32_t poolWorkers = 0;
+		uint32_t idleWorkers = 0;
+		uint32_t poolGrows = 0;
+		uint32_t poolShrinks = 0;
+	};
+
+	// Published copy of DiagTotals; getDiag() reads it without locking.
+	struct DiagSnapshot {
+		std::atomic<uint32_t> totalJobs{0};
+		std::atomic<uint32_t> runningJobs{0};
+		std::atomic<uint32_t> psramStackJobs{0};
+		std::atomic<uint32_t> deferredJobs{0};
+		std::atomic<uint32_t> startTickSum{0};
+		std::atomic<TickType_t> oldestStartTick{0};
+		std::atomic<uint32_t> poolWorkers{0};
+		std::atomic<uint32_t> idleWorkers{0};
+		std::atomic<uint32_t> poolGrows{0};
+		std::atomic<uint32_t> poolShrinks{0};
+	};
+
+	// Jobs carrying one WorkerConfig::tag, guarded by _mutex. drained is given whenever jobs
+	// drops to zero; waiters re-check jobs because the give may be stale.
+	struct TagState {
+		WorkerHandler::Impl *head = nullptr;
+		uint32_t jobs = 0;
+		uint32_t spawned = 0;
+		uint32_t completed = 0;
+		uint32_t destroyed = 0;
+		SemaphoreHandle_t drained = nullptr;
+		StaticSemaphore_t drainedBuffer{};
+	};
+
+	// Run-time counters at the start of the current core-load window. Only the caller that
+	// holds sampling updates them; coreLoadPercent keeps the last finished window.
+	struct LoadSample {
+		std::atomic<bool> sampling{false};
+		uint32_t totalRunTime = 0;
+		uint32_t idleRunTime[kESPWorkerCoreCount] = {};
+		std::atomic<uint8_t> coreLoadPercent[kESPWorkerCoreCount]{};
+	};
+
+	struct StaticSlot {
+		enum class State : uint8_t { Free, Busy, Retiring };
+
+		StaticTask_t *tcb = nullptr;
+		StackType_t *stack = nullptr;
+		State state = State::Free;
+	};
+
+	struct PoolSlot {
+		// Claimed: starting or woken, and about to take a queued job.
+		enum class State : uint8_t { Free, Claimed, Busy, Idle };
+
+		ESPWorker *owner = nullptr;
+		TaskHandle_t task = nullptr;
+		State state = State::Free;
+	};
+
+	void dispatchPooledLocked(TaskHandle_t *wakeTask, PoolSlot **growSlot);
+	void setPoolSlotStateLocked(PoolSlot &slot, PoolSlot::State state);
+	bool startPoolWorker(PoolSlot &slot);
+	static void poolTaskTrampoline(void *arg);
+	void runPoolWorker(PoolSlot &slot);
+	void runPooledJob(JobRef control);
+
+	// Bounded MPMC ring (Vyukov sequence cells) filled by submitFromISR() and drained by pool
+	// tasks.
+	struct IsrJob {
+		std::atomic<size_t> sequence{0};
+		IsrCallback callback = nullptr;
+		void *arg = nullptr;
+	};
+
+	void setupIsrRingLocked();
+	void releaseIsrRingLocked();
+	bool isrPending() const;
+	bool runIsrJob();
 
 	Config _config{};
 	std::atomic<bool> _initialized{false};
+	std::atomic<uint32_t> _nameCounter{0};
+	AtomicCounters _counters{};
 
 	mutable std::mutex _mutex;
-	std::vector<std::shared_ptr<WorkerHandler::Impl>> _activeControls;
+	std::vector<JobRef> _activeControls;
+	DiagTotals _diagTotals{};
+	// Jobs held by WorkerMemoryPolicy::Queue in FIFO order; also listed in _activeControls.
+	std::vector<JobRef> _deferredControls;
+
+	// Static allocation mode; guarded by _mutex.
+	std::vector<StaticSlot> _staticSlots;
+	size_t _staticStackBytes = 0;
+	WorkerError _staticSetupError = WorkerError::None; // why init() reserved no slots
+	void *_ownedStaticTasks = nullptr;
+	void *_ownedStaticStacks = nullptr;
+	void *_jobArena = nullptr; // BlockArena of job blocks, see worker.cpp
+
+	// Elastic pool; guarded by _mutex. A slot's state goes back to Free when its task exits or
+	// is deleted, which also tells a running pool task that it was revoked.
+	std::vector<PoolSlot> _poolSlots;
+	std::vector<JobRef> _poolQueue; // FIFO of jobs waiting for a task
 
+	// ISR submission; set up by init() and read lock-free. _isrWaiters holds, per pool slot, the
+	// task parked on its notification; submitFromISR() takes the handle before waking it.
+	IsrJob *_isrRing = nullptr;
+	size_t _isrMask = 0;
+	std::atomic<size_t> _isrEnqueuePos{0};
+	std::atomic<size_t> _isrDequeuePos{0};
+	std::atomic<TaskHandle_t> *_isrWaiters = nullptr;
+
+	// Supervisor and per-name statistics; guarded by _mutex. The timer is created with the
+	// first job that has a timeout or needs a retry, or the first debounced spawn.
+	TimerHandle_t _supervisorTimer = nullptr;
+	bool _supervisorArmed = false;
+	TickType_t _supervisorDeadline = 0;
+	uint32_t _retrySeed = 0x9E3779B9u; // xorshift state for retry jitter
+	std::vector<WorkerNameStats> _nameStats;
+	TagState _tags[kESPWorkerTagCount]{};
+	// Linear probing with backward-shift deletion, so there are no tombstones.
+	struct NameSlot {
+		WorkerHandler::Impl *control = nullptr;
+		uint32_t hash = 0;
+	};
+	std::vector<NameSlot> _nameIndex; // guarded by _mutex; empty unless Config::indexNames
+	std::vector<RateSlot> _rateSlots; // guarded by _mutex; Config::rateLimitKeys entries
+	struct HandleSlot {
+		WorkerHandler::Impl *control = nullptr;
+		uint16_t generation = 1;
+	};
+	// Guarded by _mutex; empty unless Config::slotHandles. Freed slots go on a stack reserved
+	// to the table size, so claiming and releasing never allocate.
+	std::vector<HandleSlot> _handleSlots;
+	std::vector<uint16_t> _freeHandleSlots;
+
+	// Double-buffered seqlock: writers fill _diagSnapshots[(version + 1) & 1] and then bump
+	// _diagVersion, so readers never wait on a writer that was preempted mid-update.
+	DiagSnapshot _diagSnapshots[2]{};
+	std::atomic<uint32_t> _diagVersion{0};
+	mutable LoadSample _loadSample{};
+
+	// Shared so notifying only bumps a refcount instead of copying the std::function.
 	mutable std::mutex _callbackMutex;
-	EventCallback _eventCallback{};
-	ErrorCallback _errorCallback{};
+	std::shared_ptr<const EventCallback> _eventCallback{};
+	std::shared_ptr<const ErrorCallback> _errorCallback{};
 };
+
+#include "actor.h"
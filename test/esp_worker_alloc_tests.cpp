@@ -0,0 +1,242 @@
+#include <ESPWorker.h>
+
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <new>
+
+#include "test_support.h"
+
+// Counting replacements for the global allocation functions. The stubs pause counting while
+// they model kernel allocations (task creation), so only library allocations are observed.
+// Allocations are also attributed to jobs with WorkerConfig::trackHeap.
+void *operator new(size_t size) {
+	test_support::recordOperatorNew();
+	ESPWorker::countAllocation();
+	void *ptr = std::malloc(size ? size : 1);
+	if (!ptr) {
+		throw std::bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+	std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+	std::free(ptr);
+}
+
+namespace {
+
+using test_support::expectEqual;
+using test_support::expectFalse;
+using test_support::expectTrue;
+
+void noop() {
+}
+
+int *g_kept = nullptr; // escapes the allocation so the compiler cannot elide it
+
+void testSpawnPathDoesNotUseOperatorNew() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 4;
+	worker.init(cfg);
+	worker.onEvent([](WorkerEvent) {});
+
+	size_t newBefore = test_support::operatorNewCount();
+	size_t capsBefore = test_support::heapCapsAllocationCount();
+
+	WorkerResult anonymous = worker.spawn(noop);
+	WorkerConfig named{};
+	named.name = "a-name-longer-than-the-freertos-limit";
+	WorkerResult truncated = worker.spawn([]() {}, named);
+
+	size_t newAfter = test_support::operatorNewCount();
+	size_t capsAfter = test_support::heapCapsAllocationCount();
+
+	expectTrue(static_cast<bool>(anonymous), "anonymous spawn should succeed");
+	expectTrue(static_cast<bool>(truncated), "named spawn should succeed");
+	expectEqual(newAfter - newBefore, static_cast<size_t>(0), "spawn must not call operator new");
+	expectEqual(
+	    capsAfter - capsBefore,
+	    static_cast<size_t>(2),
+	    "outside static mode each spawn still allocates its job block"
+	);
+
+	JobDiag diag = anonymous.handler->getDiag();
+	expectTrue(diag.config.name == WorkerName("worker-0"), "anonymous job should be auto-named");
+	diag = truncated.handler->getDiag();
+	expectEqual(
+	    diag.config.name.size(),
+	    kESPWorkerNameCapacity - 1,
+	    "long names should be truncated to the FreeRTOS limit"
+	);
+
+	test_support::runPendingTasks();
+	worker.deinit();
+}
+
+void testDetachedSpawnAllocatesOnlyJobState() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.indexNames = true;
+	worker.init(cfg);
+	int runs = 0;
+	std::function<void()> job = [&runs]() { runs++; };
+	WorkerConfig named{};
+	named.name = "fire";
+
+	size_t newBefore = test_support::operatorNewCount();
+	size_t capsBefore = test_support::heapCapsAllocationCount();
+	WorkerError error = worker.spawnDetached(std::move(job), named);
+	size_t newAfter = test_support::operatorNewCount();
+	size_t capsAfter = test_support::heapCapsAllocationCount();
+
+	expectEqual(error, WorkerError::None, "detached spawn should succeed");
+	expectEqual(newAfter - newBefore, static_cast<size_t>(0), "no operator new");
+	expectEqual(capsAfter - capsBefore, static_cast<size_t>(1), "one block for the job state");
+	expectTrue(worker.find("fire") == nullptr, "detached jobs are not indexed");
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(1), "job is tracked while it runs");
+
+	test_support::runPendingTasks();
+	expectEqual(runs, 1, "detached job ran");
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(0), "state released when done");
+	expectEqual(worker.getCounters().completed, static_cast<uint32_t>(1), "completion counted");
+
+	worker.deinit();
+}
+
+void testStaticSpawnsTakeJobStateFromInit() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.staticAllocation = true;
+	worker.init(cfg);
+
+	size_t capsBefore = test_support::heapCapsAllocationCount();
+	WorkerResult first = worker.spawn(noop);
+	WorkerError detached = worker.spawnDetached(noop);
+	size_t capsAfter = test_support::heapCapsAllocationCount();
+	expectTrue(static_cast<bool>(first), "static spawn should succeed");
+	expectEqual(detached, WorkerError::None, "static detached spawn should succeed");
+	expectEqual(capsAfter - capsBefore, static_cast<size_t>(0), "no heap_caps per spawn");
+
+	// Blocks go back to the arena and are reused.
+	test_support::runPendingTasks();
+	capsBefore = test_support::heapCapsAllocationCount();
+	for (int i = 0; i < 8; ++i) {
+		expectTrue(static_cast<bool>(worker.spawn(noop)), "recycled job state");
+		test_support::runPendingTasks();
+	}
+	expectEqual(test_support::heapCapsAllocationCount(), capsBefore, "still no heap_caps");
+
+	// Batch state shares the arena; strands and actors would need the heap and are refused.
+	ESPWorker::TaskCallback jobs[2] = {noop, noop};
+	WorkerBatchResult batch = worker.spawnBatch(jobs);
+	expectTrue(static_cast<bool>(batch), "static batch should succeed");
+	expectEqual(test_support::heapCapsAllocationCount(), capsBefore, "batch makes no heap_caps");
+	test_support::runPendingTasks();
+	expectTrue(batch.batch.waitAll(0), "static batch finishes");
+	batch = WorkerBatchResult{};
+	expectFalse(worker.strand().valid(), "strands are refused in static mode");
+	auto actor = worker.spawnActor<int>([](int &&) {}, 4);
+	expectEqual(actor.error(), WorkerError::InvalidConfig, "actors are refused in static mode");
+	expectEqual(test_support::heapCapsAllocationCount(), capsBefore, "refusals make no heap_caps");
+
+	// A handler kept past deinit() keeps the arena alive.
+	worker.deinit();
+	expectFalse(first.handler->getDiag().running, "kept handler still readable");
+	first = WorkerResult{};
+}
+
+void testAutoNameCounterIsPerInstance() {
+	test_support::resetRuntime();
+
+	ESPWorker first;
+	ESPWorker second;
+	first.init(ESPWorker::Config{});
+	second.init(ESPWorker::Config{});
+
+	WorkerResult a = first.spawn(noop);
+	WorkerResult b = second.spawn(noop);
+	expectTrue(
+	    a.handler->getDiag().config.name == b.handler->getDiag().config.name,
+	    "each ESPWorker should number its anonymous jobs independently"
+	);
+
+	first.deinit();
+	second.deinit();
+}
+
+void testTrackedJobsCountOperatorNew() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerConfig tracked{};
+	tracked.trackHeap = true;
+	WorkerResult counted = worker.spawn([]() { g_kept = new int(1); }, tracked);
+	WorkerResult untracked = worker.spawn([]() { delete g_kept; });
+	expectTrue(counted && untracked, "spawns should succeed");
+	test_support::runPendingTasks();
+
+	uint32_t countedAllocations = counted.handler->getDiag().heapAllocations;
+	uint32_t untrackedAllocations = untracked.handler->getDiag().heapAllocations;
+	expectEqual(countedAllocations, static_cast<uint32_t>(1), "tracked job counts its new");
+	expectEqual(untrackedAllocations, static_cast<uint32_t>(0), "tracking is opt-in");
+
+	worker.deinit();
+}
+
+void testMetricsExportDoesNotAllocate() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+	WorkerConfig named{};
+	named.name = "sensor";
+	worker.spawn(noop, named);
+	test_support::runPendingTasks();
+
+	static char buffer[8192];
+	size_t newBefore = test_support::operatorNewCount();
+	size_t capsBefore = test_support::heapCapsAllocationCount();
+	size_t length = worker.writeMetrics(buffer, sizeof(buffer));
+	size_t newAfter = test_support::operatorNewCount();
+	size_t capsAfter = test_support::heapCapsAllocationCount();
+	expectTrue(length > 0 && length < sizeof(buffer), "metrics should fit the buffer");
+	expectEqual(newAfter, newBefore, "metrics must not use operator new");
+	expectEqual(capsAfter, capsBefore, "metrics must not use heap_caps");
+
+	worker.deinit();
+}
+
+} // namespace
+
+int main() {
+	try {
+		testSpawnPathDoesNotUseOperatorNew();
+		testDetachedSpawnAllocatesOnlyJobState();
+		testStaticSpawnsTakeJobStateFromInit();
+		testAutoNameCounterIsPerInstance();
+		testTrackedJobsCountOperatorNew();
+		testMetricsExportDoesNotAllocate();
+	} catch (const std::exception &ex) {
+		std::cerr << "FAIL: " << ex.what() << '\n';
+		return 1;
+	}
+
+	std::cout << "All esp-worker allocation tests passed\n";
+	return 0;
+}
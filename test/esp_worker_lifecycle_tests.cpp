@@ -1,36 +1,22 @@
 #include <ESPWorker.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <exception>
 #include <iostream>
-#include <stdexcept>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "test_support.h"
 
 namespace {
 
-[[noreturn]] void fail(const std::string &message) {
-	throw std::runtime_error(message);
-}
-
-void expectTrue(bool condition, const std::string &message) {
-	if (!condition) {
-		fail(message);
-	}
-}
-
-void expectFalse(bool condition, const std::string &message) {
-	if (condition) {
-		fail(message);
-	}
-}
-
-template <typename T>
-void expectEqual(const T &actual, const T &expected, const std::string &message) {
-	if (!(actual == expected)) {
-		fail(message);
-	}
-}
+using test_support::expectEqual;
+using test_support::expectFalse;
+using test_support::expectTrue;
 
 void testDeinitIsSafeBeforeInit() {
 	ESPWorker worker;
@@ -168,7 +154,1512 @@ void testDestructorDelegatesToDeinit() {
 	);
 }
 
-} // namespace
+void testCountersTrackLifetimeTotals() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	worker.init(cfg);
+
+	WorkerResult first = worker.spawn([]() { vTaskDelay(5); });
+	WorkerResult second = worker.spawn([]() {});
+	WorkerResult rejected = worker.spawn([]() {});
+	WorkerConfig badStack{};
+	badStack.stackSizeBytes = 100;
+	WorkerResult invalid = worker.spawn([]() {}, badStack);
+
+	expectTrue(static_cast<bool>(first), "first counted spawn should succeed");
+	expectTrue(static_cast<bool>(second), "second counted spawn should succeed");
+	expectFalse(static_cast<bool>(rejected), "third spawn should hit maxWorkers");
+	expectFalse(static_cast<bool>(invalid), "undersized stack should be rejected");
+
+	expectEqual(
+	    test_support::runPendingTasks(),
+	    static_cast<size_t>(2),
+	    "both spawned tasks should run"
+	);
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(0), "finished jobs should be pruned");
+
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.spawned, static_cast<uint32_t>(2), "spawned counter should be 2");
+	expectEqual(counters.started, static_cast<uint32_t>(2), "started counter should be 2");
+	expectEqual(counters.completed, static_cast<uint32_t>(2), "completed counter should be 2");
+	expectEqual(counters.destroyed, static_cast<uint32_t>(0), "no job should be destroyed");
+	expectEqual(
+	    counters.errorCount(WorkerError::MaxWorkersReached),
+	    static_cast<uint32_t>(1),
+	    "maxWorkers rejection should be counted"
+	);
+	expectEqual(
+	    counters.errorCount(WorkerError::InvalidConfig),
+	    static_cast<uint32_t>(1),
+	    "invalid config rejection should be counted"
+	);
+	// Both jobs started at tick 0 and finished after the first job's 5 tick delay.
+	expectEqual(
+	    counters.busyTimeMs[0],
+	    static_cast<uint32_t>(10),
+	    "busy time should accumulate on core 0"
+	);
+
+	WorkerResult doomed = worker.spawn([]() {});
+	expectTrue(doomed.handler->destroy(), "destroy should succeed for a pending job");
+	counters = worker.getCounters();
+	expectEqual(counters.destroyed, static_cast<uint32_t>(1), "destroyed counter should be 1");
+
+	worker.init(cfg);
+	counters = worker.getCounters();
+	expectEqual(counters.spawned, static_cast<uint32_t>(0), "init should reset counters");
+
+	worker.deinit();
+}
+
+void testDiagTracksJobsIncrementally() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerDiag diag = worker.getDiag();
+	expectEqual(diag.totalJobs, static_cast<size_t>(0), "fresh worker should report no jobs");
+
+	WorkerResult first = worker.spawn([]() {});
+	vTaskDelay(10);
+	WorkerResult second = worker.spawn([]() {});
+	vTaskDelay(10);
+
+	diag = worker.getDiag();
+	expectEqual(diag.totalJobs, static_cast<size_t>(2), "diag should count both jobs");
+	expectEqual(diag.runningJobs, static_cast<size_t>(2), "both jobs should be running");
+	expectEqual(diag.waitingJobs, static_cast<size_t>(0), "no job should be waiting");
+	expectEqual(diag.maxRuntimeMs, static_cast<uint32_t>(20), "oldest job should define max");
+	expectEqual(diag.averageRuntimeMs, static_cast<uint32_t>(15), "average should be (20+10)/2");
+
+	expectTrue(first.handler->destroy(), "destroying the oldest job should succeed");
+	diag = worker.getDiag();
+	expectEqual(diag.totalJobs, static_cast<size_t>(1), "destroyed job should leave the diag");
+	expectEqual(diag.maxRuntimeMs, static_cast<uint32_t>(10), "max should move to next oldest");
+
+	test_support::runPendingTasks();
+	diag = worker.getDiag();
+	expectEqual(diag.totalJobs, static_cast<size_t>(0), "finished jobs should leave the diag");
+	expectEqual(diag.maxRuntimeMs, static_cast<uint32_t>(0), "idle pool should report no runtime");
+
+	worker.deinit();
+}
+
+void testStaticAllocationRecyclesSlots() {
+	test_support::resetRuntime();
+
+	static StaticTask_t tasks[2];
+	static StackType_t stacks[2 * 2048 / sizeof(StackType_t)];
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.stackSizeBytes = 2048;
+	cfg.staticAllocation = true;
+	cfg.staticTaskBuffers = tasks;
+	cfg.staticStackBuffer = stacks;
+	worker.init(cfg);
+
+	WorkerConfig jobCfg{};
+	jobCfg.stackSizeBytes = 2048;
+	WorkerResult first = worker.spawn([]() {}, jobCfg);
+	WorkerResult second = worker.spawn([]() {}, jobCfg);
+	expectTrue(static_cast<bool>(first), "first static spawn should succeed");
+	expectTrue(static_cast<bool>(second), "second static spawn should succeed");
+	expectEqual(
+	    first.handler->getDiag().taskHandle,
+	    static_cast<TaskHandle_t>(&tasks[0]),
+	    "static task handle should be its TCB"
+	);
+	expectEqual(
+	    worker.spawn([]() {}, jobCfg).error,
+	    WorkerError::MaxWorkersReached,
+	    "static mode should be bounded by its slot table"
+	);
+
+	WorkerConfig tooBig = jobCfg;
+	tooBig.stackSizeBytes = 4096;
+	expectEqual(
+	    worker.spawn([]() {}, tooBig).error,
+	    WorkerError::InvalidConfig,
+	    "jobs larger than a static stack slot should be rejected"
+	);
+
+	test_support::runPendingTasks();
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(0), "static jobs should complete");
+	expectEqual(
+	    test_support::deletedTaskCount(),
+	    static_cast<size_t>(0),
+	    "retired static tasks stay parked until their slot is reused"
+	);
+
+	WorkerResult third = worker.spawn([]() {}, jobCfg);
+	expectTrue(static_cast<bool>(third), "spawn should recycle a retired slot");
+	expectEqual(
+	    test_support::deletedTaskCount(),
+	    static_cast<size_t>(1),
+	    "recycling should delete the parked task first"
+	);
+	expectTrue(third.handler->destroy(), "destroying a static job should succeed");
+	WorkerResult fourth = worker.spawn([]() {}, jobCfg);
+	expectTrue(static_cast<bool>(fourth), "destroyed static slot should be reusable");
+
+	worker.deinit();
+	expectEqual(
+	    test_support::deletedTaskCount(),
+	    test_support::createdTaskCount(),
+	    "deinit should release every static task"
+	);
+}
+
+void testRejectedStaticSpawnKeepsItsSlot() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.staticAllocation = true;
+	worker.init(cfg);
+
+	// A job waiting for its retry stays active but gives its slot back, so the next spawn
+	// finds a free slot and is rejected by the job limit instead.
+	WorkerConfig retrying{};
+	retrying.retry.maxAttempts = 2;
+	retrying.retry.baseDelayMs = 10;
+	bool failedOnce = false;
+	worker.spawn(
+	    [&]() {
+		    if (!failedOnce) {
+			    failedOnce = true;
+			    ESPWorker::reportFailure();
+		    }
+	    },
+	    retrying
+	);
+	test_support::runPendingTasks();
+	expectTrue(static_cast<bool>(worker.spawn([]() {})), "second job takes the free slot");
+	expectEqual(
+	    worker.spawn([]() {}).error,
+	    WorkerError::MaxWorkersReached,
+	    "third job exceeds maxWorkers"
+	);
+
+	test_support::runPendingTasks();
+	test_support::advanceTicks(10);
+	test_support::runPendingTasks();
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(0), "every job finished");
+	expectTrue(
+	    worker.spawn([]() {}) && worker.spawn([]() {}), "rejected spawn did not keep a slot"
+	);
+
+	test_support::runPendingTasks();
+	worker.deinit();
+}
+
+void testStaticSetupFailureIsReported() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.staticAllocation = true;
+	test_support::failNextHeapCapsAllocations(1);
+	expectEqual(worker.init(cfg), WorkerError::NoMemory, "init reports the missing task table");
+	expectTrue(worker.isInitialized(), "worker still initializes");
+	expectEqual(
+	    worker.spawn([]() {}).error, WorkerError::NoMemory, "static spawns report the same error"
+	);
+	expectEqual(
+	    worker.getCounters().errorCount(WorkerError::NoMemory),
+	    static_cast<uint32_t>(2),
+	    "init and the spawn both count the failure"
+	);
+	worker.deinit();
+
+	expectEqual(worker.init(cfg), WorkerError::None, "a later init can reserve the table");
+	expectTrue(static_cast<bool>(worker.spawn([]() {})), "static spawns work again");
+	test_support::runPendingTasks();
+	worker.deinit();
+}
+
+void testStaticAllocationOwnsTableWhenNoBuffersGiven() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 3;
+	cfg.staticAllocation = true;
+	worker.init(cfg);
+	expectEqual(
+	    test_support::heapCapsAllocationCount(),
+	    static_cast<size_t>(3),
+	    "init should allocate the TCB table, stack arena and job state arena once"
+	);
+
+	WorkerResult job = worker.spawn([]() {});
+	expectTrue(static_cast<bool>(job), "spawn should use the owned static table");
+	worker.deinit();
+}
+
+void testSpawnBatchReservesSlotsTogether() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 4;
+	worker.init(cfg);
+
+	size_t created = 0;
+	worker.onEvent([&](WorkerEvent event) {
+		if (event == WorkerEvent::Created) {
+			created++;
+		}
+	});
+
+	int ran = 0;
+	ESPWorker::TaskCallback jobs[3] = {[&]() { ran++; }, [&]() { ran++; }, [&]() { ran++; }};
+	WorkerBatchResult batch = worker.spawnBatch(jobs);
+	expectTrue(static_cast<bool>(batch), "batch spawn should succeed");
+	expectEqual(batch.spawned, static_cast<size_t>(3), "all batch jobs should spawn");
+	expectEqual(batch.batch.remaining(), static_cast<size_t>(3), "no batch job has finished");
+	expectEqual(created, static_cast<size_t>(3), "each batch job should emit Created");
+	expectFalse(batch.batch.waitAll(0), "waitAll should time out while jobs are pending");
+
+	ESPWorker::TaskCallback more[2] = {[&]() { ran++; }, [&]() { ran++; }};
+	WorkerBatchResult rejected = worker.spawnBatch(more);
+	expectEqual(
+	    rejected.error,
+	    WorkerError::MaxWorkersReached,
+	    "all-or-nothing batch should be rejected when slots are short"
+	);
+	expectTrue(static_cast<bool>(more[0]) && static_cast<bool>(more[1]), "callbacks stay intact");
+
+	WorkerBatchResult partial = worker.spawnBatch(more, WorkerConfig{}, WorkerBatchPolicy::Partial);
+	expectTrue(static_cast<bool>(partial), "partial batch should succeed");
+	expectEqual(partial.spawned, static_cast<size_t>(1), "partial batch should fill the last slot");
+	expectTrue(static_cast<bool>(more[1]), "unspawned callbacks stay with the caller");
+
+	test_support::runPendingTasks();
+	expectEqual(ran, 4, "every spawned batch job should run");
+	expectEqual(batch.batch.remaining(), static_cast<size_t>(0), "batch should drain");
+	expectTrue(batch.batch.waitAll(0), "waitAll should succeed once every job finished");
+	expectTrue(partial.batch.waitAll(0), "partial batch should complete");
+	expectEqual(worker.getCounters().spawned, static_cast<uint32_t>(4), "spawned counts per job");
+
+	worker.deinit();
+}
+
+void testMemoryGovernorRejectsWhenInternalHeapIsLow() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.minFreeInternalBytes = 16 * 1024;
+	cfg.minLargestInternalBlock = 8 * 1024;
+	worker.init(cfg);
+
+	WorkerError reported = WorkerError::None;
+	worker.onError([&](WorkerError error) { reported = error; });
+
+	test_support::setHeapFree(18 * 1024, 64 * 1024);
+	WorkerResult rejected = worker.spawn([]() {});
+	expectEqual(
+	    rejected.error,
+	    WorkerError::InsufficientMemory,
+	    "spawn should be rejected when the stack would eat into the internal reserve"
+	);
+	expectEqual(reported, WorkerError::InsufficientMemory, "rejection should reach onError");
+	expectEqual(test_support::createdTaskCount(), static_cast<size_t>(0), "no task is created");
+
+	test_support::setHeapFree(64 * 1024, 4 * 1024);
+	expectEqual(
+	    worker.spawn([]() {}).error,
+	    WorkerError::InsufficientMemory,
+	    "spawn should be rejected when the largest free block is too small"
+	);
+
+	test_support::setHeapFree(64 * 1024, 64 * 1024);
+	WorkerResult admitted = worker.spawn([]() {});
+	expectTrue(static_cast<bool>(admitted), "spawn should succeed once memory recovered");
+	expectEqual(
+	    admitted.handler->getDiag().admission,
+	    WorkerAdmission::Immediate,
+	    "job should report immediate admission"
+	);
+	expectEqual(
+	    worker.getCounters().errorCount(WorkerError::InsufficientMemory),
+	    static_cast<uint32_t>(2),
+	    "rejections should be counted"
+	);
+
+	// With a retry policy the rejected job backs off and starts once memory recovered.
+	WorkerConfig retrying{};
+	retrying.retry.maxAttempts = 2;
+	retrying.retry.baseDelayMs = 10;
+	test_support::setHeapFree(18 * 1024, 64 * 1024);
+	bool ran = false;
+	WorkerResult backedOff = worker.spawn([&]() { ran = true; }, retrying);
+	expectTrue(backedOff && backedOff.handler->getDiag().retryPending, "rejection backs off");
+	expectEqual(
+	    worker.getCounters().errorCount(WorkerError::InsufficientMemory),
+	    static_cast<uint32_t>(3),
+	    "backed-off rejection still reported"
+	);
+	test_support::setHeapFree(64 * 1024, 64 * 1024);
+	test_support::advanceTicks(10);
+	test_support::runPendingTasks();
+	expectTrue(ran && backedOff.handler->wait(0), "retry admits the job once memory recovered");
+
+	test_support::runPendingTasks();
+	worker.deinit();
+}
+
+void testMemoryGovernorQueuesUntilMemoryRecovers() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.minFreeInternalBytes = 8 * 1024;
+	cfg.memoryPolicy = WorkerMemoryPolicy::Queue;
+	cfg.admissionQueueDepth = 1;
+	worker.init(cfg);
+
+	std::vector<int> order;
+	WorkerResult first = worker.spawn([&]() { order.push_back(1); });
+	expectTrue(static_cast<bool>(first), "first spawn should be admitted");
+
+	// 10 KiB free: a 4 KiB stack would leave less than the 8 KiB reserve.
+	test_support::setHeapFree(10 * 1024, 10 * 1024);
+	WorkerResult second = worker.spawn([&]() { order.push_back(2); });
+	expectTrue(static_cast<bool>(second), "low memory should queue the job, not fail it");
+	JobDiag queued = second.handler->getDiag();
+	expectEqual(queued.admission, WorkerAdmission::Deferred, "job should report deferral");
+	expectTrue(queued.queued && queued.running, "deferred job should be pending");
+	expectTrue(queued.taskHandle == nullptr, "deferred job should not have a task yet");
+	expectEqual(test_support::createdTaskCount(), static_cast<size_t>(1), "only one task exists");
+	expectEqual(worker.getDiag().deferredJobs, static_cast<size_t>(1), "diag counts the queue");
+	expectEqual(worker.getDiag().waitingJobs, static_cast<size_t>(1), "queued job is waiting");
+
+	WorkerResult overflow = worker.spawn([]() {});
+	expectEqual(
+	    overflow.error,
+	    WorkerError::InsufficientMemory,
+	    "spawn should fail once the admission queue is full"
+	);
+
+	// The finishing job's stack is credited back, which makes room for the queued one.
+	test_support::runPendingTasks();
+	expectEqual(order.size(), static_cast<size_t>(2), "queued job should run after the first");
+	expectEqual(order[1], 2, "queued job should run second");
+	expectTrue(second.handler->wait(0), "queued job should complete");
+	expectFalse(second.handler->getDiag().queued, "completed job is no longer queued");
+	expectEqual(worker.getDiag().deferredJobs, static_cast<size_t>(0), "queue should drain");
+
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.deferred, static_cast<uint32_t>(1), "deferral should be counted");
+	expectEqual(counters.completed, static_cast<uint32_t>(2), "both jobs should complete");
+
+	worker.deinit();
+}
+
+void testElasticPoolGrowsUnderLoadAndShrinksWhenIdle() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.elasticPool = true;
+	cfg.idleTimeoutMs = 100;
+	worker.init(cfg);
+
+	std::vector<int> order;
+	WorkerResult first = worker.spawn([&]() { order.push_back(1); });
+	WorkerResult second = worker.spawn([&]() { order.push_back(2); });
+	WorkerResult third = worker.spawn([&]() { order.push_back(3); });
+	expectTrue(first && second && third, "pooled spawns should succeed");
+	expectTrue(first.handler->getDiag().pooled, "job should report that it is pooled");
+	expectEqual(
+	    test_support::createdTaskCount(),
+	    static_cast<size_t>(2),
+	    "the pool should grow to maxWorkers and queue the rest"
+	);
+
+	WorkerDiag busy = worker.getDiag();
+	expectEqual(busy.poolWorkers, static_cast<size_t>(2), "two pool tasks should exist");
+	expectEqual(busy.poolGrows, static_cast<uint32_t>(2), "both tasks count as grows");
+	expectEqual(busy.waitingJobs, static_cast<size_t>(3), "jobs wait for a pool task");
+
+	test_support::runPendingTasks();
+	expectEqual(order.size(), static_cast<size_t>(3), "every pooled job should run");
+	expectEqual(order[0], 1, "pooled jobs should start in FIFO order");
+	expectEqual(order[2], 3, "pooled jobs should start in FIFO order");
+	expectTrue(third.handler->wait(0), "pooled job should signal completion");
+
+	WorkerDiag idle = worker.getDiag();
+	expectEqual(idle.poolWorkers, static_cast<size_t>(0), "idle tasks should exit");
+	expectEqual(idle.poolShrinks, static_cast<uint32_t>(2), "both exits count as shrinks");
+	expectEqual(worker.activeWorkers(), static_cast<size_t>(0), "no job should stay active");
+	expectEqual(worker.getCounters().completed, static_cast<uint32_t>(3), "jobs should complete");
+
+	worker.deinit();
+}
+
+void testElasticPoolReusesBusyTasksAtMaxWorkers() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 1;
+	cfg.elasticPool = true;
+	cfg.idleTimeoutMs = 50;
+	worker.init(cfg);
+
+	std::vector<int> order;
+	WorkerResult nested{};
+	WorkerResult outer = worker.spawn([&]() {
+		order.push_back(1);
+		nested = worker.spawn([&]() { order.push_back(2); });
+	});
+	expectTrue(static_cast<bool>(outer), "pooled spawn should succeed");
+
+	test_support::runPendingTasks();
+	expectTrue(static_cast<bool>(nested), "spawn from a pooled job should queue");
+	expectEqual(order.size(), static_cast<size_t>(2), "queued job should run on the same task");
+	expectEqual(test_support::createdTaskCount(), static_cast<size_t>(1), "pool stays at one task");
+
+	WorkerConfig dedicated{};
+	dedicated.stackSizeBytes = cfg.stackSizeBytes * 2;
+	WorkerResult large = worker.spawn([]() {}, dedicated);
+	expectTrue(static_cast<bool>(large), "oversized job should get its own task");
+	expectFalse(large.handler->getDiag().pooled, "oversized job is not pooled");
+	test_support::runPendingTasks();
+
+	worker.deinit();
+}
+
+void testElasticPoolKeepsMinWorkers() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 4;
+	cfg.minWorkers = 2;
+	cfg.elasticPool = true;
+	worker.init(cfg);
+
+	expectEqual(test_support::createdTaskCount(), static_cast<size_t>(2), "init prestarts tasks");
+	expectEqual(worker.getDiag().poolWorkers, static_cast<size_t>(2), "diag reports the pool");
+
+	worker.deinit();
+	expectEqual(test_support::deletedTaskCount(), static_cast<size_t>(2), "deinit stops the pool");
+	expectEqual(worker.getDiag().poolWorkers, static_cast<size_t>(0), "pool is empty after deinit");
+}
+
+void testStrandRunsJobsInOrderOnOneDrain() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerStrand bus = worker.strand("i2c");
+	expectTrue(bus.valid(), "strand should be created");
+	expectEqual(std::string(bus.name()), std::string("i2c"), "strand keeps its name");
+
+	std::vector<int> order;
+	int depth = 0;
+	int maxDepth = 0;
+	auto job = [&](int id) {
+		return [&, id]() {
+			depth++;
+			maxDepth = std::max(maxDepth, depth);
+			order.push_back(id);
+			depth--;
+		};
+	};
+
+	expectEqual(bus.post(job(1)), WorkerError::None, "first post should schedule a drain");
+	expectEqual(bus.post(job(2)), WorkerError::None, "posts to an active strand should queue");
+	auto postsFromStrand = [&]() {
+		order.push_back(3);
+		bus.post(job(4));
+	};
+	expectEqual(bus.post(postsFromStrand), WorkerError::None, "third post should queue");
+	expectEqual(bus.pending(), static_cast<size_t>(3), "posted jobs should be pending");
+	expectEqual(test_support::createdTaskCount(), static_cast<size_t>(1), "one drain job at a time");
+
+	test_support::runPendingTasks();
+	expectEqual(order, std::vector<int>({1, 2, 3, 4}), "strand jobs should run in post order");
+	expectEqual(maxDepth, 1, "strand jobs should never overlap");
+	expectEqual(bus.pending(), static_cast<size_t>(0), "strand should drain");
+	expectEqual(
+	    test_support::createdTaskCount(),
+	    static_cast<size_t>(1),
+	    "a job posted from the strand should run on the same drain"
+	);
+
+	expectEqual(bus.post(job(5)), WorkerError::None, "idle strand should accept new jobs");
+	test_support::runPendingTasks();
+	expectEqual(order.back(), 5, "idle strand should be rescheduled");
+
+	// A drain that cannot start leaves the job queued and accepted; the next post runs it.
+	test_support::failNextTaskCreates(1);
+	expectEqual(bus.post(job(6)), WorkerError::None, "deferred job is still accepted");
+	expectEqual(bus.pending(), static_cast<size_t>(1), "deferred job stays queued");
+	expectEqual(bus.post(job(7)), WorkerError::None, "next post schedules the drain");
+	test_support::runPendingTasks();
+	expectEqual(order, std::vector<int>({1, 2, 3, 4, 5, 6, 7}), "deferred job runs once, in order");
+	expectEqual(bus.post(nullptr), WorkerError::InvalidConfig, "empty callbacks are rejected");
+
+	worker.deinit();
+}
+
+void testStrandUsesPooledWorkers() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.elasticPool = true;
+	cfg.idleTimeoutMs = 10;
+	worker.init(cfg);
+
+	WorkerStrand sd = worker.strand("sd");
+	WorkerStrand spi = worker.strand();
+	std::vector<int> order;
+	sd.post([&]() { order.push_back(1); });
+	spi.post([&]() { order.push_back(10); });
+	sd.post([&]() { order.push_back(2); });
+
+	test_support::runPendingTasks();
+	expectEqual(order.size(), static_cast<size_t>(3), "both strands should drain");
+	expectTrue(
+	    std::find(order.begin(), order.end(), 1) < std::find(order.begin(), order.end(), 2),
+	    "each strand keeps its own order"
+	);
+	expectEqual(worker.getDiag().poolGrows, static_cast<uint32_t>(2), "drains ran on pool tasks");
+
+	worker.deinit();
+}
+
+void testActorMovesMessagesThroughBoundedMailbox() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.elasticPool = true;
+	worker.init(cfg);
+
+	std::vector<int> received;
+	auto actor = worker.spawnActor<std::unique_ptr<int>>(
+	    [&](std::unique_ptr<int> &&message) { received.push_back(*message); }, 3
+	);
+	expectTrue(static_cast<bool>(actor), "actor should spawn");
+	expectFalse(actor.handler()->getDiag().pooled, "actors get a dedicated task");
+
+	expectTrue(actor.post(std::make_unique<int>(1)), "post should queue a move-only message");
+	expectTrue(actor.tryPost(std::make_unique<int>(2)), "tryPost should queue");
+	BaseType_t woken = pdFALSE;
+	expectTrue(actor.postFromISR(std::make_unique<int>(3), &woken), "ISR post should queue");
+	expectTrue(actor.tryPost(std::make_unique<int>(4)), "capacity rounds up to four");
+	expectFalse(actor.tryPost(std::make_unique<int>(5)), "tryPost should drop when full");
+	expectFalse(actor.post(std::make_unique<int>(6), 2), "post should time out when full");
+
+	JobDiag diag = actor.handler()->getDiag();
+	expectEqual(diag.mailboxCapacity, static_cast<size_t>(4), "diag reports mailbox capacity");
+	expectEqual(diag.mailboxDepth, static_cast<size_t>(4), "diag reports mailbox depth");
+	expectEqual(diag.mailboxDropped, static_cast<uint32_t>(2), "diag reports drops");
+
+	actor.stop();
+	expectFalse(actor.tryPost(std::make_unique<int>(7)), "stopped actor should refuse posts");
+	test_support::runPendingTasks();
+	expectEqual(received, std::vector<int>({1, 2, 3, 4}), "messages arrive in order");
+	expectTrue(actor.wait(0), "actor should finish after stop()");
+	expectEqual(
+	    actor.handler()->getDiag().mailboxDelivered,
+	    static_cast<uint32_t>(4),
+	    "diag reports delivered messages"
+	);
+
+	// A destroyed actor refuses posts instead of queueing them for nobody.
+	auto destroyed = worker.spawnActor<int>([](int &&) {}, 1);
+	expectTrue(destroyed.tryPost(1), "actor queues before destroy()");
+	expectTrue(destroyed.handler()->destroy(), "actor can be destroyed");
+	expectFalse(destroyed.tryPost(2), "tryPost fails after destroy()");
+	expectFalse(destroyed.post(3), "post on a full mailbox fails instead of blocking");
+	expectFalse(destroyed.postFromISR(4, &woken), "ISR post fails after destroy()");
+	expectEqual(
+	    destroyed.handler()->getDiag().mailboxDropped,
+	    static_cast<uint32_t>(3),
+	    "posts after destroy() count as drops"
+	);
+	test_support::runPendingTasks();
+
+	auto invalid = worker.spawnActor<int>([](int &&) {}, 0);
+	expectEqual(invalid.error(), WorkerError::InvalidConfig, "zero capacity is rejected");
+
+	worker.deinit();
+}
+
+void testSubmitFromISRRunsOnPoolTasks() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	expectEqual(
+	    worker.submitFromISR([](void *) {}, nullptr).error,
+	    WorkerError::NotInitialized,
+	    "ISR submission needs init()"
+	);
+
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.elasticPool = true;
+	cfg.idleTimeoutMs = 10;
+	cfg.isrQueueDepth = 3;
+	worker.init(cfg);
+
+	int runs = 0;
+	std::string order;
+	auto bump = [](void *arg) { ++*static_cast<int *>(arg); };
+	auto recordIsr = [](void *arg) { *static_cast<std::string *>(arg) += 'i'; };
+	for (int i = 0; i < 4; ++i) {
+		WorkerIsrResult result = worker.submitFromISR(bump, &runs);
+		expectTrue(static_cast<bool>(result), "ring should accept up to its rounded capacity");
+		expectEqual(result.yieldRequired, pdFALSE, "no parked pool task to wake yet");
+	}
+	expectEqual(
+	    worker.submitFromISR(bump, &runs).error,
+	    WorkerError::MaxWorkersReached,
+	    "full ring should reject"
+	);
+	expectEqual(
+	    worker.submitFromISR(nullptr, nullptr).error,
+	    WorkerError::InvalidConfig,
+	    "null callback should be rejected"
+	);
+	expectEqual(runs, 0, "nothing runs in the ISR itself");
+
+	bool pooledRan = false;
+	expectTrue(static_cast<bool>(worker.spawn([&]() { pooledRan = true; })), "spawn should work");
+	test_support::runPendingTasks();
+	expectTrue(pooledRan, "pooled job should run");
+	expectEqual(runs, 4, "pool task should drain the ISR ring");
+
+	// Queued jobs and ISR submissions take turns instead of one draining first.
+	for (int i = 0; i < 3; ++i) {
+		worker.submitFromISR(recordIsr, &order);
+	}
+	for (int i = 0; i < 2; ++i) {
+		worker.spawn([&]() { order += 'p'; });
+	}
+	test_support::runPendingTasks();
+	expectEqual(order, std::string("pipii"), "pool tasks interleave both sources");
+
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.isrSubmitted, static_cast<uint32_t>(7), "accepted submissions counted");
+	expectEqual(counters.isrCompleted, static_cast<uint32_t>(7), "ISR callbacks counted");
+	expectEqual(
+	    counters.errorCount(WorkerError::MaxWorkersReached),
+	    static_cast<uint32_t>(1),
+	    "rejected submissions counted"
+	);
+	worker.deinit();
+
+	cfg.isrQueueDepth = 0;
+	worker.init(cfg);
+	expectEqual(
+	    worker.submitFromISR(bump, &runs).error,
+	    WorkerError::InvalidConfig,
+	    "ISR submission needs isrQueueDepth"
+	);
+	worker.deinit();
+}
+
+void testSupervisorTimesOutSlowJobs() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	worker.init(cfg);
+
+	size_t timedOutEvents = 0;
+	worker.onEvent([&](WorkerEvent event) {
+		if (event == WorkerEvent::TimedOut) {
+			timedOutEvents++;
+		}
+	});
+
+	WorkerConfig slowCfg{};
+	slowCfg.name = "bus-read";
+	slowCfg.timeoutMs = 50;
+	bool sawStop = false;
+	WorkerResult slow = worker.spawn(
+	    [&]() {
+		    test_support::advanceTicks(49);
+		    expectFalse(ESPWorker::stopRequested(), "no stop request before the deadline");
+		    test_support::advanceTicks(1);
+		    sawStop = ESPWorker::stopRequested();
+	    },
+	    slowCfg
+	);
+
+	WorkerConfig reportCfg = slowCfg;
+	reportCfg.timeoutMs = 10;
+	reportCfg.timeoutPolicy = WorkerTimeoutPolicy::Report;
+	bool reportStopped = true;
+	WorkerResult report = worker.spawn(
+	    [&]() {
+		    test_support::advanceTicks(20);
+		    reportStopped = ESPWorker::stopRequested();
+	    },
+	    reportCfg
+	);
+
+	WorkerConfig fastCfg = slowCfg;
+	fastCfg.name = "fast";
+	WorkerResult fast = worker.spawn([]() {}, fastCfg);
+	expectTrue(slow && report && fast, "spawns should succeed");
+
+	test_support::runPendingTasks();
+	expectTrue(sawStop, "RequestStop should set the job's stop flag at the deadline");
+	expectFalse(reportStopped, "Report should leave the stop flag alone");
+	expectTrue(slow.handler->getDiag().timedOut, "diag should mark the slow job");
+	expectTrue(slow.handler->getDiag().stopRequested, "diag should show the stop request");
+	expectFalse(fast.handler->getDiag().timedOut, "jobs that finish in time are not flagged");
+	expectEqual(timedOutEvents, static_cast<size_t>(2), "each timeout raises TimedOut");
+	expectEqual(worker.getCounters().timedOut, static_cast<uint32_t>(2), "timeouts are counted");
+	expectEqual(
+	    worker.getNameStats("bus-read").timeouts,
+	    static_cast<uint32_t>(2),
+	    "timeouts are aggregated per job name"
+	);
+	expectEqual(
+	    worker.getNameStats("fast").timeouts,
+	    static_cast<uint32_t>(0),
+	    "names without timeouts report zero"
+	);
+	test_support::advanceTicks(100);
+	expectEqual(timedOutEvents, static_cast<size_t>(2), "finished jobs never time out");
+	expectEqual(test_support::advanceTicks(100), static_cast<size_t>(0), "supervisor goes idle");
+
+	WorkerHandler manual = *fast.handler;
+	manual.requestStop();
+	expectTrue(manual.stopRequested(), "requestStop should be visible on the handler");
+	expectFalse(ESPWorker::stopRequested(), "outside a job there is nothing to stop");
+
+	worker.deinit();
+}
+
+void testRetryBacksOffWithoutHoldingATask() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	worker.init(cfg);
+
+	size_t started = 0;
+	size_t completed = 0;
+	worker.onEvent([&](WorkerEvent event) {
+		started += event == WorkerEvent::Started;
+		completed += event == WorkerEvent::Completed;
+	});
+
+	WorkerConfig jobCfg{};
+	jobCfg.retry.maxAttempts = 3;
+	jobCfg.retry.baseDelayMs = 10;
+	jobCfg.retry.multiplier = 2.0f;
+	int runs = 0;
+	WorkerResult flaky = worker.spawn(
+	    [&]() {
+		    if (++runs < 3) {
+			    ESPWorker::reportFailure();
+		    }
+	    },
+	    jobCfg
+	);
+	expectTrue(static_cast<bool>(flaky), "spawn should succeed");
+
+	test_support::runPendingTasks();
+	JobDiag diag = flaky.handler->getDiag();
+	expectTrue(diag.retryPending && diag.running, "failed job should wait for its retry");
+	expectEqual(diag.attempts, static_cast<uint8_t>(1), "first attempt counted");
+	expectFalse(flaky.handler->wait(0), "wait should not return between attempts");
+	expectEqual(worker.getDiag().runningJobs, static_cast<size_t>(0), "backoff holds no task");
+
+	test_support::advanceTicks(9);
+	expectEqual(test_support::runPendingTasks(), static_cast<size_t>(0), "retry waits baseDelay");
+	test_support::advanceTicks(1);
+	test_support::runPendingTasks();
+	expectEqual(runs, 2, "second attempt runs after baseDelayMs");
+
+	test_support::advanceTicks(19);
+	expectEqual(test_support::runPendingTasks(), static_cast<size_t>(0), "delay doubles");
+	test_support::advanceTicks(1);
+	test_support::runPendingTasks();
+	expectEqual(runs, 3, "third attempt runs after the doubled delay");
+
+	diag = flaky.handler->getDiag();
+	expectTrue(flaky.handler->wait(0), "job should finish after a successful attempt");
+	expectEqual(diag.attempts, static_cast<uint8_t>(3), "attempts reported in JobDiag");
+	expectFalse(diag.failed || diag.retryPending, "last attempt succeeded");
+	expectEqual(started, static_cast<size_t>(3), "every attempt raises Started");
+	expectEqual(completed, static_cast<size_t>(1), "Completed is raised once");
+	expectEqual(worker.getCounters().retries, static_cast<uint32_t>(2), "retries counted");
+
+	// Task creation failures back off too instead of failing the spawn.
+	test_support::failNextTaskCreates(1);
+	bool ran = false;
+	jobCfg.retry.maxAttempts = 2;
+	WorkerResult retried = worker.spawn([&]() { ran = true; }, jobCfg);
+	expectTrue(static_cast<bool>(retried), "spawn should hand out a handler for the retry");
+	expectTrue(retried.handler->getDiag().retryPending, "creation failure should back off");
+	expectEqual(
+	    worker.getCounters().errorCount(WorkerError::TaskCreateFailed),
+	    static_cast<uint32_t>(1),
+	    "failed creation is still reported"
+	);
+	test_support::advanceTicks(10);
+	test_support::runPendingTasks();
+	expectTrue(ran && retried.handler->wait(0), "second attempt should run the job");
+
+	// So does a task whose stack or TCB could not be allocated.
+	test_support::failNextTaskAllocations(1);
+	ran = false;
+	WorkerResult starved = worker.spawn([&]() { ran = true; }, jobCfg);
+	expectTrue(starved && starved.handler->getDiag().retryPending, "NoMemory should back off");
+	expectEqual(
+	    worker.getCounters().errorCount(WorkerError::NoMemory),
+	    static_cast<uint32_t>(1),
+	    "out-of-memory creation reported as NoMemory"
+	);
+	test_support::advanceTicks(10);
+	test_support::runPendingTasks();
+	expectTrue(ran && starved.handler->wait(0), "retry should run the job once memory is back");
+
+	// Without retries the failure is final.
+	test_support::failNextTaskCreates(1);
+	WorkerResult failed = worker.spawn([]() {});
+	expectEqual(failed.error, WorkerError::TaskCreateFailed, "no retry policy, no retry");
+	test_support::failNextTaskAllocations(1);
+	expectEqual(worker.spawn([]() {}).error, WorkerError::NoMemory, "final NoMemory failure");
+
+	worker.deinit();
+}
+
+} // namespace
+
+void testCpuTimeComesFromRunTimeStats() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerConfig named{};
+	named.name = "fft";
+	WorkerResult job = worker.spawn(
+	    []() {
+		    test_support::consumeCpu(600000);
+		    vTaskDelay(900); // blocked time counts toward runtimeMs only
+	    },
+	    named
+	);
+	expectTrue(static_cast<bool>(job), "spawn should succeed");
+	test_support::runPendingTasks();
+
+	JobDiag diag = job.handler->getDiag();
+	expectEqual(diag.cpuTimeUs, static_cast<uint32_t>(600000), "cpu time from the task counter");
+	expectEqual(diag.runtimeMs, static_cast<uint32_t>(900), "wall-clock runtime kept apart");
+	expectEqual(
+	    worker.getCounters().cpuTimeUs[0], static_cast<uint32_t>(600000), "cpu time per core"
+	);
+	expectEqual(
+	    worker.getNameStats("fft").cpuTimeUsSum, static_cast<uint64_t>(600000), "cpu time per name"
+	);
+
+	test_support::consumeCpu(400000);
+	test_support::addIdleRunTime(0, 250000);
+	test_support::addIdleRunTime(1, 1000000);
+	WorkerDiag pool = worker.getDiag();
+	expectEqual(pool.coreLoadPercent[0], static_cast<uint8_t>(75), "core 0 idle a quarter");
+	expectEqual(pool.coreLoadPercent[1], static_cast<uint8_t>(0), "core 1 fully idle");
+
+	test_support::consumeCpu(1000);
+	expectEqual(
+	    worker.getDiag().coreLoadPercent[0],
+	    static_cast<uint8_t>(75),
+	    "short windows keep the previous sample"
+	);
+
+	worker.deinit();
+}
+
+void testTrackedJobsRecordHeapDeltas() {
+	test_support::resetRuntime();
+	test_support::setHeapFree(200000, 100000, 50000);
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerConfig tracked{};
+	tracked.name = "logger";
+	tracked.trackHeap = true;
+	WorkerResult leaky = worker.spawn(
+	    []() {
+		    test_support::setHeapFree(199488, 100000, 49872);
+		    ESPWorker::countAllocation();
+		    ESPWorker::countAllocation();
+	    },
+	    tracked
+	);
+	WorkerResult tidy = worker.spawn(
+	    []() {
+		    test_support::setHeapFree(199616, 100000, 49872); // frees 128 bytes
+	    },
+	    tracked
+	);
+	WorkerResult untracked = worker.spawn([]() {
+		test_support::setHeapFree(190000, 100000, 40000);
+		ESPWorker::countAllocation();
+	});
+	expectTrue(leaky && tidy && untracked, "spawns should succeed");
+	test_support::runPendingTasks();
+
+	JobDiag diag = leaky.handler->getDiag();
+	expectEqual(diag.internalHeapDelta, static_cast<int32_t>(512), "internal bytes kept");
+	expectEqual(diag.psramHeapDelta, static_cast<int32_t>(128), "PSRAM bytes kept");
+	expectEqual(diag.heapAllocations, static_cast<uint32_t>(2), "counted allocations");
+	expectEqual(
+	    tidy.handler->getDiag().internalHeapDelta, static_cast<int32_t>(-128), "freed bytes"
+	);
+	JobDiag quiet = untracked.handler->getDiag();
+	expectEqual(quiet.internalHeapDelta, static_cast<int32_t>(0), "untracked job has no delta");
+	expectEqual(quiet.heapAllocations, static_cast<uint32_t>(0), "untracked job counts nothing");
+
+	WorkerNameStats stats = worker.getNameStats("logger");
+	expectEqual(stats.internalHeapDeltaSum, static_cast<int64_t>(384), "per-name internal sum");
+	expectEqual(stats.psramHeapDeltaSum, static_cast<int64_t>(128), "per-name PSRAM sum");
+	expectEqual(stats.heapAllocations, static_cast<uint32_t>(2), "per-name allocations");
+
+	worker.deinit();
+}
+
+void testTagsDestroyAndWaitPerGroup() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	constexpr uint8_t kOta = 3;
+	constexpr uint8_t kMqtt = 5;
+	WorkerConfig ota{};
+	ota.tag = kOta;
+	WorkerConfig mqtt{};
+	mqtt.tag = kMqtt;
+	WorkerResult otaJobs[3] = {
+	    worker.spawn([]() {}, ota),
+	    worker.spawn([]() {}, ota),
+	    worker.spawn([]() {}, ota),
+	};
+	WorkerResult publish = worker.spawn([]() {}, mqtt);
+	WorkerResult untagged = worker.spawn([]() {});
+	for (const auto &job : otaJobs) {
+		expectTrue(static_cast<bool>(job), "tagged spawn should succeed");
+	}
+	expectTrue(publish && untagged, "spawns should succeed");
+
+	WorkerConfig badTag{};
+	badTag.tag = kESPWorkerTagCount;
+	expectEqual(
+	    worker.spawn([]() {}, badTag).error, WorkerError::InvalidConfig, "tag out of range"
+	);
+
+	WorkerTagDiag diag = worker.getDiag(kOta);
+	expectEqual(diag.jobs, static_cast<size_t>(3), "three ota jobs");
+	expectEqual(diag.runningJobs, static_cast<size_t>(3), "ota jobs are running");
+	expectEqual(diag.spawned, static_cast<uint32_t>(3), "ota spawned count");
+	expectFalse(worker.waitTag(kOta, 0), "ota jobs still alive");
+
+	expectEqual(worker.destroyTag(kOta), static_cast<size_t>(3), "destroyTag hits the tag only");
+	diag = worker.getDiag(kOta);
+	expectEqual(diag.jobs, static_cast<size_t>(0), "ota list emptied");
+	expectEqual(diag.destroyed, static_cast<uint32_t>(3), "ota destroyed count");
+	expectTrue(worker.waitTag(kOta, 0), "waitTag returns once the tag is empty");
+	expectEqual(worker.getDiag().totalJobs, static_cast<size_t>(2), "other jobs untouched");
+	expectEqual(worker.getDiag(kMqtt).jobs, static_cast<size_t>(1), "mqtt job untouched");
+
+	test_support::runPendingTasks();
+	expectTrue(worker.waitTag(kMqtt, 0), "mqtt tag drains when its job returns");
+	expectEqual(worker.getDiag(kMqtt).completed, static_cast<uint32_t>(1), "mqtt completed");
+	expectTrue(untagged.handler->wait(0), "untagged job ran");
+
+	worker.deinit();
+}
+
+void testNameIndexFindsAndDeduplicatesJobs() {
+	test_support::resetRuntime();
+
+	ESPWorker plain;
+	plain.init(ESPWorker::Config{});
+	expectEqual(
+	    plain.spawnUnique("sync", []() {}).error,
+	    WorkerError::InvalidConfig,
+	    "spawnUnique needs the name index"
+	);
+	plain.deinit();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.indexNames = true;
+	worker.init(cfg);
+
+	int runs = 0;
+	WorkerResult first = worker.spawnUnique("sync", [&]() { runs++; });
+	WorkerResult second = worker.spawnUnique("sync", [&]() { runs += 10; });
+	expectTrue(first && second, "both calls succeed");
+	expectFalse(first.existing, "first call spawns");
+	expectTrue(second.existing, "second call joins the running job");
+	expectTrue(second.handler == first.handler, "same handler is returned");
+	expectTrue(worker.find("sync") == first.handler, "find returns the handler");
+	expectEqual(worker.getCounters().spawned, static_cast<uint32_t>(1), "spawned once");
+
+	// Enough names to share probe runs in the 16-slot table, then drop some from the middle.
+	const char *names[] = {"n0", "n1", "n2", "n3", "n4", "n5"};
+	std::shared_ptr<WorkerHandler> handlers[6];
+	for (size_t i = 0; i < 6; ++i) {
+		WorkerConfig named{};
+		named.name = names[i];
+		handlers[i] = worker.spawn([]() {}, named).handler;
+		expectTrue(static_cast<bool>(handlers[i]), "named spawn should succeed");
+	}
+	handlers[1]->destroy();
+	handlers[4]->destroy();
+	for (size_t i = 0; i < 6; ++i) {
+		bool alive = i != 1 && i != 4;
+		expectTrue((worker.find(names[i]) == handlers[i]) == alive, "index follows destroy");
+	}
+
+	test_support::runPendingTasks();
+	expectEqual(runs, 1, "only the first callback ran");
+	expectTrue(worker.find("sync") == nullptr, "finished jobs leave the index");
+	WorkerResult third = worker.spawnUnique("sync", [&]() { runs++; });
+	expectFalse(third.existing, "a finished name spawns again");
+	test_support::runPendingTasks();
+	expectEqual(runs, 2, "new job ran");
+
+	worker.deinit();
+}
+
+void testCoalescingMergesQueuedAndFollowUpRuns() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	std::vector<int> ran;
+	WorkerConfig keyed{};
+	keyed.coalesceKey = 7;
+	WorkerConfig latest = keyed;
+	latest.coalesceLatestWins = true;
+
+	WorkerResult first = worker.spawn([&]() { ran.push_back(1); }, keyed);
+	WorkerResult dropped = worker.spawn([&]() { ran.push_back(2); }, keyed);
+	WorkerResult replaced = worker.spawn(
+	    [&]() {
+		    ran.push_back(3);
+		    // While running, merges queue one follow-up run of the latest payload.
+		    WorkerResult followUp = worker.spawn([&]() { ran.push_back(4); }, keyed);
+		    worker.spawn([&]() { ran.push_back(5); }, latest);
+		    expectTrue(followUp.existing, "running job accepts a follow-up");
+	    },
+	    latest
+	);
+	expectTrue(first && dropped && replaced, "all spawns succeed");
+	expectFalse(first.existing, "first spawn starts the job");
+	expectTrue(dropped.existing && replaced.existing, "later spawns merge");
+	expectTrue(dropped.handler == first.handler, "waiters share one handler");
+	expectTrue(replaced.handler == first.handler, "latest-wins merge shares the handler");
+
+	test_support::runPendingTasks();
+	expectTrue(ran == std::vector<int>({3, 5}), "latest payload and one follow-up ran");
+	expectEqual(first.handler->getDiag().coalesced, static_cast<uint32_t>(4), "merges counted");
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.spawned, static_cast<uint32_t>(1), "one job spawned");
+	expectEqual(counters.coalesced, static_cast<uint32_t>(4), "counter tracks merges");
+
+	WorkerResult later = worker.spawn([&]() { ran.push_back(6); }, keyed);
+	expectFalse(later.existing, "a finished key spawns again");
+	WorkerConfig other{};
+	other.coalesceKey = 8;
+	expectFalse(worker.spawn([]() {}, other).existing, "keys coalesce separately");
+	test_support::runPendingTasks();
+	expectEqual(ran.back(), 6, "new job ran");
+
+	worker.deinit();
+}
+
+void testDebounceAndThrottleTrackKeys() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.rateLimitKeys = 2;
+	worker.init(cfg);
+
+	int throttled = 0;
+	WorkerResult first = worker.spawnThrottled(1, 100, [&]() { throttled++; });
+	WorkerResult dropped = worker.spawnThrottled(1, 100, [&]() { throttled += 10; });
+	expectTrue(first && first.handler && !first.suppressed, "first throttled spawn runs");
+	expectTrue(dropped && !dropped.handler && dropped.suppressed, "second one is dropped");
+	test_support::advanceTicks(100);
+	expectTrue(worker.spawnThrottled(1, 100, [&]() { throttled++; }).handler != nullptr, "reopens");
+	test_support::runPendingTasks();
+	expectEqual(throttled, 2, "only accepted callbacks ran");
+	WorkerRateStats stats = worker.getRateStats(1);
+	expectEqual(stats.accepted, static_cast<uint32_t>(2), "throttle accepted");
+	expectEqual(stats.suppressed, static_cast<uint32_t>(1), "throttle suppressed");
+
+	// A spawn that fails is not counted and leaves the window open.
+	test_support::advanceTicks(100);
+	test_support::failNextTaskCreates(1);
+	expectEqual(
+	    worker.spawnThrottled(1, 100, [&]() { throttled += 10; }).error,
+	    WorkerError::TaskCreateFailed,
+	    "failed throttled spawn reports its error"
+	);
+	WorkerResult reopened = worker.spawnThrottled(1, 100, [&]() { throttled++; });
+	expectTrue(reopened.handler != nullptr, "window stays open after a failure");
+	test_support::runPendingTasks();
+	expectEqual(throttled, 3, "the retried callback ran");
+	expectEqual(worker.getRateStats(1).accepted, static_cast<uint32_t>(3), "failure not accepted");
+
+	std::vector<int> debounced;
+	for (int i = 1; i <= 3; ++i) {
+		WorkerResult r =
+		    worker.spawnDebounced(2, 50, [&debounced, i]() { debounced.push_back(i); });
+		expectTrue(r && !r.handler, "debounced spawns return no handler");
+	}
+	test_support::advanceTicks(30);
+	worker.spawnDebounced(2, 50, [&]() { debounced.push_back(4); });
+	test_support::advanceTicks(30);
+	test_support::runPendingTasks();
+	expectTrue(debounced.empty(), "a new submission restarts the window");
+	expectTrue(worker.getRateStats(2).pending, "callback still pending");
+	test_support::advanceTicks(20);
+	test_support::runPendingTasks();
+	expectTrue(debounced == std::vector<int>({4}), "only the latest callback ran once");
+	stats = worker.getRateStats(2);
+	expectEqual(stats.accepted, static_cast<uint32_t>(1), "debounce fired once");
+	expectEqual(stats.suppressed, static_cast<uint32_t>(3), "earlier callbacks superseded");
+	expectFalse(stats.pending, "nothing pending after firing");
+
+	// Once the throttle interval is over both keys are idle, so new keys evict them; two pending
+	// keys fill the table.
+	test_support::advanceTicks(100);
+	expectTrue(static_cast<bool>(worker.spawnDebounced(3, 10, []() {})), "evicts an idle key");
+	expectTrue(static_cast<bool>(worker.spawnDebounced(4, 10, []() {})), "evicts the other");
+	expectEqual(
+	    worker.spawnDebounced(5, 10, []() {}).error,
+	    WorkerError::MaxWorkersReached,
+	    "busy table rejects new keys"
+	);
+	expectEqual(worker.getRateStats(1).accepted, static_cast<uint32_t>(0), "evicted stats reset");
+	expectEqual(
+	    worker.spawnThrottled(3, 10, []() {}).error,
+	    WorkerError::InvalidConfig,
+	    "a key keeps its mode"
+	);
+	WorkerRateStats all[4];
+	expectEqual(worker.getRateStats(all, 4), static_cast<size_t>(2), "two keys tracked");
+
+	worker.deinit();
+}
+
+void testCheapNamedJobsRunInline() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.rateLimitKeys = 1;
+	worker.init(cfg);
+	std::vector<WorkerEvent> events;
+	worker.onEvent([&](WorkerEvent event) { events.push_back(event); });
+
+	WorkerConfig tiny{};
+	tiny.name = "tiny";
+	tiny.inlineIfCheaperThanUs = 100;
+	WorkerConfig heavy = tiny;
+	heavy.name = "heavy";
+
+	// Unknown names run on a task first so their CPU time is learned.
+	worker.spawn([]() { test_support::consumeCpu(20); }, tiny);
+	worker.spawn([]() { test_support::consumeCpu(500); }, heavy);
+	test_support::runPendingTasks();
+	expectEqual(worker.getNameStats("tiny").cpuTimeUsEwma, static_cast<uint32_t>(20), "learned");
+	const size_t tasksBefore = test_support::createdTaskCount();
+	events.clear();
+
+	bool ran = false;
+	WorkerResult inlined = worker.spawn([&]() { ran = true; }, tiny);
+	expectTrue(inlined && ran, "cheap job ran before spawn returned");
+	expectEqual(test_support::createdTaskCount(), tasksBefore, "no task for the inline job");
+	expectTrue(inlined.handler->wait(0), "wait sees the inline job finished");
+	JobDiag diag = inlined.handler->getDiag();
+	expectTrue(diag.ranInline && !diag.running, "diag reports the inline run");
+	expectTrue(
+	    events ==
+	        std::vector<WorkerEvent>(
+	            {WorkerEvent::Created, WorkerEvent::Started, WorkerEvent::Completed}
+	        ),
+	    "inline jobs raise the usual events"
+	);
+
+	WorkerResult tasked = worker.spawn([]() {}, heavy);
+	expectFalse(tasked.handler->getDiag().ranInline, "expensive names keep their task");
+	expectEqual(test_support::createdTaskCount(), tasksBefore + 1, "heavy job got a task");
+	test_support::runPendingTasks();
+	expectEqual(worker.getCounters().inlined, static_cast<uint32_t>(1), "inline runs counted");
+
+	// The Destroy policy deletes the job's task on timeout, which an inline job does not have.
+	WorkerConfig destroyed = tiny;
+	destroyed.timeoutMs = 10;
+	destroyed.timeoutPolicy = WorkerTimeoutPolicy::Destroy;
+	WorkerResult guarded = worker.spawn([]() {}, destroyed);
+	expectFalse(guarded.handler->getDiag().ranInline, "Destroy timeouts keep their task");
+	test_support::runPendingTasks();
+
+	// Debounced callbacks are spawned from the supervisor timer, whose service task must not run
+	// them.
+	bool debounced = false;
+	worker.spawnDebounced(1, 10, [&]() { debounced = true; }, tiny);
+	test_support::advanceTicks(10);
+	expectFalse(debounced, "debounced job not run on the timer service task");
+	test_support::runPendingTasks();
+	expectTrue(debounced, "debounced job ran on its own task");
+	expectEqual(worker.getCounters().inlined, static_cast<uint32_t>(1), "no further inline runs");
+
+	worker.deinit();
+}
+
+void testValueHandlesShareOneJob() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.indexNames = true;
+	worker.init(cfg);
+
+	WorkerHandler copy;
+	expectFalse(copy.valid(), "default handle is empty");
+	{
+		WorkerResult result = worker.spawnUnique("value", []() {});
+		expectTrue(result.handle.valid(), "spawn fills the value handle");
+		copy = result.handle;
+		WorkerResult again = worker.spawnUnique("value", []() {});
+		expectTrue(again.existing && again.handle == copy, "handles compare by job");
+		expectTrue(result.handler->getDiag().running, "shared handler sees the same job");
+	}
+	// The shared handler is gone; the copy alone keeps the job state alive.
+	expectTrue(copy.getDiag().running, "copy outlives the result");
+	test_support::runPendingTasks();
+	expectTrue(copy.wait(0), "wait through the value handle");
+	WorkerHandler moved = std::move(copy);
+	expectFalse(copy.valid(), "moved-from handle is empty");
+	expectFalse(moved.getDiag().running, "moved handle still reads the finished job");
+
+	WorkerConfig plain{};
+	WorkerResult first = worker.spawn([]() {}, plain);
+	WorkerResult second = worker.spawn([]() {}, plain);
+	expectTrue(first.handle != second.handle, "different jobs differ");
+	expectTrue(first.handle.destroy(), "destroy through the value handle");
+	expectTrue(first.handler->getDiag().destroyed, "shared handler sees the destroy");
+	test_support::runPendingTasks();
+
+	worker.deinit();
+}
+
+void testSlotHandlesLookUpLiveJobs() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxWorkers = 2;
+	cfg.slotHandles = true;
+	worker.init(cfg);
+
+	WorkerResult first = worker.spawn([]() {});
+	WorkerResult second = worker.spawn([]() {});
+	expectTrue(first.slot.valid() && second.slot.valid(), "spawn fills the slot handle");
+	expectTrue(first.slot.index != second.slot.index, "live jobs use different slots");
+	WorkerSlotHandle copied = WorkerSlotHandle::fromRaw(first.slot.raw());
+	expectTrue(copied == first.slot, "handles round-trip through uint32_t");
+
+	JobDiag diag{};
+	expectTrue(worker.getDiag(copied, &diag) && diag.running, "diag through the slot");
+	expectFalse(worker.wait(copied, 0), "wait times out while the job is pending");
+	expectTrue(worker.destroy(second.slot), "destroy through the slot");
+	expectTrue(second.handler->getDiag().destroyed, "slot names the same job");
+	test_support::runPendingTasks();
+
+	expectTrue(worker.wait(copied, 0), "stale handle means the job finished");
+	expectFalse(worker.getDiag(copied, &diag), "no diag for a finished job");
+	expectFalse(worker.destroy(copied), "nothing to destroy");
+	WorkerResult third = worker.spawn([]() {});
+	expectTrue(third.slot.valid() && third.slot != copied, "reused slot gets a new generation");
+	expectFalse(worker.wait(WorkerSlotHandle{7, 1}, 0), "never-issued index fails");
+	expectFalse(worker.wait(WorkerSlotHandle{}, 0), "empty handle fails");
+	test_support::runPendingTasks();
+	worker.deinit();
+
+	worker.init(ESPWorker::Config{});
+	WorkerResult plain = worker.spawn([]() {});
+	expectFalse(plain.slot.valid(), "slot handles are opt-in");
+	test_support::runPendingTasks();
+	worker.deinit();
+}
+
+void testWaitKeepsTaskNotifications() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	WorkerHandler later;
+	bool waited = true;
+	uint32_t kept = 0;
+	WorkerResult waiter = worker.spawn([&]() {
+		xTaskNotifyGive(xTaskGetCurrentTaskHandle());
+		waited = later.wait(10);
+		kept = ulTaskNotifyTake(pdTRUE, 0);
+	});
+	later = worker.spawn([]() {}).handle;
+	test_support::runPendingTasks();
+
+	expectFalse(waited, "wait times out while the other job is pending");
+	expectEqual(kept, static_cast<uint32_t>(1), "foreign notification is given back");
+	expectTrue(later.wait(0) && later.wait(0), "every wait after completion succeeds");
+	expectTrue(waiter.handle.wait(), "waiter finished too");
+
+	worker.deinit();
+}
+
+// Runs the pending tasks on a second thread that reports the given core, so the calling thread
+// can wait on a job while it runs.
+std::thread runTasksOnCore(BaseType_t core) {
+	return std::thread([core]() {
+		test_support::setCurrentCore(core);
+		test_support::runPendingTasks();
+	});
+}
+
+void testWaitSpinsOnlyForShortJobs() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxSpinWaitUs = 200;
+	worker.init(cfg);
+	WorkerConfig fast{};
+	fast.name = "fast";
+	WorkerConfig slow{};
+	slow.name = "slow";
+	worker.spawn([]() { test_support::consumeCpu(20); }, fast);
+	worker.spawn([]() { test_support::consumeCpu(5000); }, slow);
+	test_support::runPendingTasks();
+
+	WorkerResult pending = worker.spawn([]() {});
+	expectFalse(pending.handler->wait(0), "polling wait does not spin");
+	expectFalse(pending.handler->wait(5), "pending job still times out");
+	expectEqual(worker.getCounters().spinWaits, static_cast<uint32_t>(0), "no spin before start");
+	test_support::runPendingTasks();
+
+	// Each job below is held on the runner thread until the wait has given up.
+	std::atomic<bool> started{false};
+	std::atomic<bool> release{false};
+	auto waitWhileHeld = [&](const WorkerConfig &config, BaseType_t core) {
+		started = false;
+		release = false;
+		WorkerResult held = worker.spawn(
+		    [&]() {
+			    started = true;
+			    while (!release) {
+				    std::this_thread::yield();
+			    }
+		    },
+		    config
+		);
+		std::thread runner = runTasksOnCore(core);
+		while (!started) {
+			std::this_thread::yield();
+		}
+		const bool finished = held.handler->wait(5);
+		release = true;
+		runner.join();
+		return finished;
+	};
+
+	expectFalse(waitWhileHeld(WorkerConfig{}, 1), "unknown job times out");
+	expectEqual(worker.getCounters().spinWaits, static_cast<uint32_t>(1), "unknown job spins");
+	expectFalse(waitWhileHeld(fast, 1), "cheap job times out");
+	expectEqual(worker.getCounters().spinWaits, static_cast<uint32_t>(2), "cheap name spins");
+	expectFalse(waitWhileHeld(slow, 1), "costly job times out");
+	expectFalse(waitWhileHeld(fast, xPortGetCoreID()), "job on this core times out");
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.spinWaits, static_cast<uint32_t>(2), "no spin when useless");
+	expectEqual(counters.spinJoins, static_cast<uint32_t>(0), "no spin saw a job finish");
+
+	worker.deinit();
+}
+
+void testWaitSpinJoinsJobFinishingOnOtherCore() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxSpinWaitUs = 2000000;
+	worker.init(cfg);
+
+	std::atomic<bool> started{false};
+	WorkerResult result = worker.spawn([&]() {
+		started = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	});
+	std::thread runner = runTasksOnCore(1);
+	while (!started) {
+		std::this_thread::yield();
+	}
+	const bool finished = result.handler->wait();
+	runner.join();
+	expectTrue(finished, "job finished inside the spin window");
+	WorkerCounters counters = worker.getCounters();
+	expectEqual(counters.spinWaits, static_cast<uint32_t>(1), "wait spun on the running job");
+	expectEqual(counters.spinJoins, static_cast<uint32_t>(1), "spin saw the job finish");
+
+	worker.deinit();
+}
+
+void testHandlersOutliveTheirWorker() {
+	test_support::resetRuntime();
+
+	WorkerResult finished;
+	WorkerResult torndown;
+	{
+		ESPWorker worker;
+		worker.init(ESPWorker::Config{});
+		finished = worker.spawn([]() {});
+		test_support::runPendingTasks();
+		torndown = worker.spawn([]() {});
+		worker.deinit();
+		expectTrue(torndown.handler->wait(0), "deinit completes pending jobs");
+		expectTrue(torndown.handler->getDiag().destroyed, "torn-down job reads destroyed");
+	}
+	// The worker is gone; both handlers answer from the job state alone.
+	expectTrue(finished.handler->wait(), "finished job waits without its worker");
+	expectTrue(finished.handler->destroy(), "destroying a finished job needs no worker");
+	expectTrue(torndown.handle.wait(10), "torn-down job waits without its worker");
+}
 
 int main() {
 	try {
@@ -177,6 +1668,37 @@ int main() {
 		testReinitLifecycleAfterDeinit();
 		testDeinitReleasesActiveTaskHandles();
 		testDestructorDelegatesToDeinit();
+		testCountersTrackLifetimeTotals();
+		testDiagTracksJobsIncrementally();
+		testStaticAllocationRecyclesSlots();
+		testRejectedStaticSpawnKeepsItsSlot();
+		testStaticSetupFailureIsReported();
+		testStaticAllocationOwnsTableWhenNoBuffersGiven();
+		testSpawnBatchReservesSlotsTogether();
+		testMemoryGovernorRejectsWhenInternalHeapIsLow();
+		testMemoryGovernorQueuesUntilMemoryRecovers();
+		testElasticPoolGrowsUnderLoadAndShrinksWhenIdle();
+		testElasticPoolReusesBusyTasksAtMaxWorkers();
+		testElasticPoolKeepsMinWorkers();
+		testStrandRunsJobsInOrderOnOneDrain();
+		testStrandUsesPooledWorkers();
+		testActorMovesMessagesThroughBoundedMailbox();
+		testSubmitFromISRRunsOnPoolTasks();
+		testSupervisorTimesOutSlowJobs();
+		testRetryBacksOffWithoutHoldingATask();
+		testCpuTimeComesFromRunTimeStats();
+		testTrackedJobsRecordHeapDeltas();
+		testTagsDestroyAndWaitPerGroup();
+		testNameIndexFindsAndDeduplicatesJobs();
+		testCoalescingMergesQueuedAndFollowUpRuns();
+		testDebounceAndThrottleTrackKeys();
+		testCheapNamedJobsRunInline();
+		testValueHandlesShareOneJob();
+		testSlotHandlesLookUpLiveJobs();
+		testWaitKeepsTaskNotifications();
+		testHandlersOutliveTheirWorker();
+		testWaitSpinsOnlyForShortJobs();
+		testWaitSpinJoinsJobFinishingOnOtherCore();
 	} catch (const std::exception &ex) {
 		std::cerr << "FAIL: " << ex.what() << '\n';
 		return 1;
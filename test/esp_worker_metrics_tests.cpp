@@ -0,0 +1,137 @@
+#include <ESPWorker.h>
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "test_support.h"
+
+namespace {
+
+using test_support::expectEqual;
+using test_support::expectFalse;
+using test_support::expectTrue;
+
+bool contains(const std::string &text, const std::string &needle) {
+	return text.find(needle) != std::string::npos;
+}
+
+void testMetricsUseOpenMetricsTextFormat() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	worker.init(cfg);
+
+	WorkerConfig sensorCfg{};
+	sensorCfg.name = "sensor";
+	// Run one at a time: runtime counts from spawn.
+	worker.spawn([]() {}, sensorCfg);
+	test_support::runPendingTasks();
+	worker.spawn([]() { test_support::advanceTicks(50); }, sensorCfg);
+	test_support::runPendingTasks();
+	worker.spawn(
+	    []() {
+		    test_support::consumeCpu(1500);
+		    test_support::advanceTicks(2500);
+	    },
+	    sensorCfg
+	);
+	test_support::runPendingTasks();
+	worker.spawn([]() {});
+	test_support::runPendingTasks();
+
+	char buffer[8192];
+	size_t length = worker.writeMetrics(buffer, sizeof(buffer));
+	expectTrue(length > 0 && length < sizeof(buffer), "metrics should fit the buffer");
+	expectEqual(strlen(buffer), length, "buffer form should NUL-terminate");
+	const std::string text(buffer);
+
+	expectTrue(contains(text, "# TYPE espworker_jobs_spawned counter\n"), "counter TYPE line");
+	expectTrue(contains(text, "\nespworker_jobs_spawned_total 4\n"), "counters use _total");
+	expectTrue(contains(text, "\nespworker_jobs_completed_total 4\n"), "completed counter");
+	expectTrue(
+	    contains(text, "espworker_errors_total{error=\"MaxWorkersReached\"} 0\n"),
+	    "errors are labelled by WorkerError"
+	);
+	expectTrue(contains(text, "espworker_busy_seconds_total{core=\"0\"} 2.550\n"), "busy time");
+	expectTrue(contains(text, "espworker_cpu_seconds_total{core=\"0\"} 0.001500\n"), "cpu time");
+	expectTrue(
+	    contains(text, "espworker_job_cpu_seconds_total{name=\"sensor\"} 0.001500\n"),
+	    "cpu time per name"
+	);
+	expectTrue(contains(text, "espworker_core_load_percent{core=\"1\"} 0\n"), "core load");
+	expectTrue(contains(text, "# TYPE espworker_running_jobs gauge\n"), "gauge TYPE line");
+	expectTrue(contains(text, "\nespworker_running_jobs 0\n"), "running gauge");
+	expectTrue(contains(text, "\nespworker_psram_stack_jobs 0\n"), "PSRAM gauge");
+
+	const std::string series = "espworker_job_runtime_seconds";
+	expectTrue(contains(text, "# TYPE " + series + " histogram\n"), "histogram TYPE line");
+	expectTrue(contains(text, series + "_bucket{name=\"sensor\",le=\"0.001\"} 1\n"), "le 1ms");
+	expectTrue(contains(text, series + "_bucket{name=\"sensor\",le=\"0.100\"} 2\n"), "cumulative");
+	expectTrue(contains(text, series + "_bucket{name=\"sensor\",le=\"1.000\"} 2\n"), "le 1s");
+	expectTrue(contains(text, series + "_bucket{name=\"sensor\",le=\"10.000\"} 3\n"), "le 10s");
+	expectTrue(contains(text, series + "_bucket{name=\"sensor\",le=\"+Inf\"} 3\n"), "+Inf");
+	expectTrue(contains(text, series + "_sum{name=\"sensor\"} 2.550\n"), "histogram sum");
+	expectTrue(contains(text, series + "_count{name=\"sensor\"} 3\n"), "histogram count");
+	expectFalse(contains(text, "worker-"), "unnamed jobs are not labelled");
+
+	expectTrue(text.size() >= 6 && text.compare(text.size() - 6, 6, "# EOF\n") == 0, "ends in EOF");
+	std::istringstream lines(text);
+	std::string line;
+	while (std::getline(lines, line)) {
+		expectFalse(line.empty(), "no blank lines");
+		if (line[0] == '#') {
+			continue;
+		}
+		size_t space = line.rfind(' ');
+		expectTrue(space != std::string::npos && space + 1 < line.size(), "sample has a value");
+		expectEqual(line.compare(0, 10, "espworker_"), 0, "samples use the espworker_ prefix");
+	}
+
+	worker.deinit();
+}
+
+void testMetricsTruncateSafely() {
+	test_support::resetRuntime();
+
+	ESPWorker worker;
+	worker.init(ESPWorker::Config{});
+
+	size_t needed = worker.writeMetrics(nullptr, 0);
+	char small[64];
+	size_t reported = worker.writeMetrics(small, sizeof(small));
+	expectEqual(reported, needed, "truncated writes still report the full length");
+	expectEqual(strlen(small), sizeof(small) - 1, "truncated output stays NUL-terminated");
+
+	size_t totals[2] = {0, 0}; // chunks, bytes
+	worker.streamMetrics(
+	    [](const char *, size_t length, void *context) {
+		    auto *sums = static_cast<size_t *>(context);
+		    sums[0]++;
+		    sums[1] += length;
+	    },
+	    totals
+	);
+	expectTrue(totals[0] > 1, "sink form streams line by line");
+	expectEqual(totals[1], needed, "sink and buffer forms produce the same text");
+
+	worker.deinit();
+}
+
+} // namespace
+
+int main() {
+	try {
+		testMetricsUseOpenMetricsTextFormat();
+		testMetricsTruncateSafely();
+	} catch (const std::exception &ex) {
+		std::cerr << "FAIL: " << ex.what() << '\n';
+		return 1;
+	}
+
+	std::cout << "All esp-worker metrics tests passed\n";
+	return 0;
+}
@@ -0,0 +1,124 @@
+// Join latency of WorkerHandler::wait() with and without Config::maxSpinWaitUs, measured through
+// the library on the host stubs. Two threads play the two cores: a waiter job on core 0 joins a
+// named job that busy-runs for a fixed time on core 1 and records how long after that job ended
+// wait() returned. The stubs block the waiter on its task notification, so the blocking path
+// pays a real thread wake-up; the spin budget is learned from the job's reported CPU time.
+//
+// Built with the tests but not registered with ctest; run it by hand:
+//   ./build/test/esp_worker_wait_bench
+
+#include <ESPWorker.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "test_support.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRounds = 1000;
+constexpr uint32_t kMaxSpinUs = 200;
+
+int64_t nowNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch())
+	    .count();
+}
+
+void busyFor(uint32_t us) {
+	const int64_t end = nowNs() + static_cast<int64_t>(us) * 1000;
+	while (nowNs() < end) {
+	}
+}
+
+std::thread runTasksOnCore(BaseType_t core) {
+	return std::thread([core]() {
+		test_support::setCurrentCore(core);
+		test_support::runPendingTasks();
+	});
+}
+
+// Returns the nanoseconds between the end of each job and its waiter getting control back.
+std::vector<int64_t> measure(uint32_t jobUs, uint32_t maxSpinWaitUs) {
+	test_support::resetRuntime();
+	test_support::setBlockingNotifyTake(true);
+	ESPWorker worker;
+	ESPWorker::Config cfg{};
+	cfg.maxSpinWaitUs = maxSpinWaitUs;
+	worker.init(cfg);
+	WorkerConfig jobConfig{};
+	jobConfig.name = "job";
+
+	std::vector<int64_t> latencies;
+	latencies.reserve(kRounds);
+	for (int i = 0; i < kRounds; ++i) {
+		std::atomic<bool> waiterReady{false};
+		std::atomic<bool> jobStarted{false};
+		std::atomic<int64_t> endNs{0};
+		std::atomic<int64_t> wakeNs{0};
+		WorkerHandler target;
+		// Queued first so the core 0 thread picks it up; it joins once the job is running.
+		worker.spawn([&]() {
+			waiterReady = true;
+			while (!jobStarted) {
+			}
+			target.wait();
+			wakeNs = nowNs();
+		});
+		WorkerResult job = worker.spawn(
+		    [&]() {
+			    jobStarted = true;
+			    busyFor(jobUs);
+			    test_support::consumeCpu(jobUs);
+			    endNs = nowNs();
+		    },
+		    jobConfig
+		);
+		target = job.handle;
+
+		std::thread core0 = runTasksOnCore(0);
+		while (!waiterReady) {
+		}
+		std::thread core1 = runTasksOnCore(1);
+		core1.join();
+		core0.join();
+		latencies.push_back(wakeNs - endNs);
+	}
+	worker.deinit();
+	return latencies;
+}
+
+int64_t percentile(std::vector<int64_t> samples, size_t percent) {
+	std::sort(samples.begin(), samples.end());
+	return samples[std::min(samples.size() - 1, samples.size() * percent / 100)];
+}
+
+} // namespace
+
+int main() {
+	// Like spinBudgetLocked() on a single-core chip: with one CPU the spin only delays the job.
+	if (std::thread::hardware_concurrency() < 2) {
+		std::printf("needs at least two CPUs; spinning cannot help on one\n");
+		return 0;
+	}
+	std::printf("job_us  block_p50_us  block_p99_us  spin_p50_us  spin_p99_us\n");
+	for (uint32_t jobUs : {1u, 5u, 20u, 50u, 100u}) {
+		const std::vector<int64_t> blocked = measure(jobUs, 0);
+		const std::vector<int64_t> spun = measure(jobUs, kMaxSpinUs);
+		std::printf(
+		    "%6u  %12.2f  %12.2f  %11.2f  %11.2f\n",
+		    static_cast<unsigned>(jobUs),
+		    percentile(blocked, 50) / 1000.0,
+		    percentile(blocked, 99) / 1000.0,
+		    percentile(spun, 50) / 1000.0,
+		    percentile(spun, 99) / 1000.0
+		);
+	}
+	return 0;
+}
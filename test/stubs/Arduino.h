@@ -2,6 +2,8 @@
 
 #include <stdint.h>
 
+#define IRAM_ATTR
+
 #ifdef __cplusplus
 extern "C" {
 #endif
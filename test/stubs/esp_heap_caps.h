@@ -13,6 +13,8 @@ extern "C" {
 void *heap_caps_malloc(size_t size, unsigned int caps);
 void heap_caps_free(void *ptr);
 size_t heap_caps_get_total_size(unsigned int caps);
+size_t heap_caps_get_free_size(unsigned int caps);
+size_t heap_caps_get_largest_free_block(unsigned int caps);
 
 #ifdef __cplusplus
 }
@@ -19,17 +19,33 @@ typedef struct StaticSemaphore {
 	uintptr_t storage[8];
 } StaticSemaphore_t;
 
+typedef struct StaticTask {
+	uintptr_t storage[16];
+} StaticTask_t;
+
 #define pdTRUE 1
 #define pdFALSE 0
 #define pdPASS 1
 #define pdFAIL 0
+#define errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY (-1)
 
 #define portMAX_DELAY ((TickType_t) - 1)
 #define portTICK_PERIOD_MS 1
 #define tskNO_AFFINITY (-1)
+#define portNUM_PROCESSORS 2
+#define configMAX_TASK_NAME_LEN 16
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configGENERATE_RUN_TIME_STATS 1
+#define INCLUDE_xTaskGetIdleTaskHandle 1
+
+// Run-time stats clock in microseconds, advanced by test_support::consumeCpu().
+uint32_t stubRunTimeCounterValue(void);
+#define portGET_RUN_TIME_COUNTER_VALUE() stubRunTimeCounterValue()
 
 #define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
 
+BaseType_t xPortGetCoreID(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -8,6 +8,15 @@ extern "C" {
 
 typedef void (*TaskFunction_t)(void *);
 
+typedef enum {
+	eRunning = 0,
+	eReady,
+	eBlocked,
+	eSuspended,
+	eDeleted,
+	eInvalid,
+} eTaskState;
+
 BaseType_t xTaskCreatePinnedToCore(
     TaskFunction_t task,
     const char *name,
@@ -18,10 +27,32 @@ BaseType_t xTaskCreatePinnedToCore(
     BaseType_t coreId
 );
 
+TaskHandle_t xTaskCreateStaticPinnedToCore(
+    TaskFunction_t task,
+    const char *name,
+    uint32_t stackDepth,
+    void *parameters,
+    UBaseType_t priority,
+    StackType_t *stackBuffer,
+    StaticTask_t *taskBuffer,
+    BaseType_t coreId
+);
+
 void vTaskDelete(TaskHandle_t task);
+void vTaskSuspend(TaskHandle_t task);
+eTaskState eTaskGetState(TaskHandle_t task);
 void vTaskDelay(TickType_t ticks);
 TickType_t xTaskGetTickCount(void);
 TaskHandle_t xTaskGetCurrentTaskHandle(void);
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task);
+TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t coreId);
+
+#define taskYIELD() ((void)0)
 
 #ifdef __cplusplus
 }
@@ -2,10 +2,62 @@
 
 #include <stddef.h>
 
+#include "freertos/FreeRTOS.h"
+
+#include <stdexcept>
+#include <string>
+
 namespace test_support {
 
+[[noreturn]] inline void fail(const std::string &message) {
+	throw std::runtime_error(message);
+}
+
+inline void expectTrue(bool condition, const std::string &message) {
+	if (!condition) {
+		fail(message);
+	}
+}
+
+inline void expectFalse(bool condition, const std::string &message) {
+	if (condition) {
+		fail(message);
+	}
+}
+
+template <typename T>
+void expectEqual(const T &actual, const T &expected, const std::string &message) {
+	if (!(actual == expected)) {
+		fail(message);
+	}
+}
+
 void resetRuntime();
 size_t createdTaskCount();
 size_t deletedTaskCount();
+size_t runPendingTasks();
+// The next count calls to xTaskCreatePinnedToCore() fail with pdFAIL.
+void failNextTaskCreates(size_t count);
+// Like failNextTaskCreates(), but they fail with errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY.
+void failNextTaskAllocations(size_t count);
+// The next count calls to heap_caps_malloc() return nullptr.
+void failNextHeapCapsAllocations(size_t count);
+// Moves the tick count forward and runs the software timers that came due; returns how many fired.
+size_t advanceTicks(TickType_t ticks);
+// Advances the run-time stats clock and credits the time to the task running the caller, if any.
+void consumeCpu(uint32_t us);
+// Lets a task's ulTaskNotifyTake(portMAX_DELAY) block until it is notified; off after
+// resetRuntime(). Only safe when the notifying task runs on another thread.
+void setBlockingNotifyTake(bool blocking);
+// Core reported by xPortGetCoreID() on the calling thread; 0 until set.
+void setCurrentCore(BaseType_t core);
+// Credits time to a core's idle task without moving the run-time stats clock.
+void addIdleRunTime(BaseType_t core, uint32_t us);
+
+size_t heapCapsAllocationCount();
+void recordOperatorNew(); // called by the counting operator new in allocation tests
+size_t operatorNewCount();
+// Values reported by heap_caps_get_free_size()/heap_caps_get_largest_free_block().
+void setHeapFree(size_t internalFree, size_t internalLargestBlock, size_t psramFree = 0);
 
 } // namespace test_support
@@ -2,13 +2,17 @@
 #include "esp_heap_caps.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "freertos/timers.h"
 #include "test_support.h"
 
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>
 #include <cstdlib>
 #include <mutex>
 #include <new>
 #include <unordered_set>
+#include <vector>
 
 namespace {
 
@@ -19,16 +23,81 @@ struct FakeSemaphore {
 struct FakeTask {
 	TaskFunction_t entry{nullptr};
 	void *arg{nullptr};
+	bool isStatic{false};
+	bool suspended{false};
+	UBaseType_t priority{0};
+	uint32_t notifications{0};
+	uint32_t runTime{0};
 };
 
+struct FakeTimer {
+	TickType_t period{0};
+	bool autoReload{false};
+	void *id{nullptr};
+	TimerCallbackFunction_t callback{nullptr};
+	bool active{false};
+	TickType_t expiry{0};
+};
+
+static_assert(sizeof(FakeTask) <= sizeof(StaticTask_t), "FakeTask must fit in StaticTask_t");
+
 std::atomic<TickType_t> g_tickCount{0};
 std::atomic<size_t> g_createdTasks{0};
 std::atomic<size_t> g_deletedTasks{0};
+std::atomic<size_t> g_heapCapsAllocations{0};
+constexpr size_t kDefaultInternalFree = 256 * 1024;
+constexpr size_t kDefaultInternalLargestBlock = 128 * 1024;
+std::atomic<size_t> g_internalFree{kDefaultInternalFree};
+std::atomic<size_t> g_internalLargestBlock{kDefaultInternalLargestBlock};
+std::atomic<size_t> g_psramFree{0};
+std::atomic<size_t> g_operatorNewAllocations{0};
+std::atomic<size_t> g_failingTaskCreates{0};
+std::atomic<size_t> g_failingTaskAllocations{0};
+std::atomic<size_t> g_failingHeapCapsAllocations{0};
+std::atomic<uint32_t> g_runTimeCounter{0};
+std::atomic<uint32_t> g_idleRunTime[portNUM_PROCESSORS]{};
+char g_idleTasks[portNUM_PROCESSORS]; // addresses stand in for the idle task handles
+thread_local int g_allocationTrackingPaused = 0;
+
+// The stubs' own bookkeeping models kernel allocations and stays out of the counters.
+struct StubAllocationScope {
+	StubAllocationScope() {
+		g_allocationTrackingPaused++;
+	}
+	~StubAllocationScope() {
+		g_allocationTrackingPaused--;
+	}
+};
 
 std::mutex g_taskMutex;
+std::condition_variable g_taskNotified; // signalled under g_taskMutex by xTaskNotifyGive()
+bool g_blockingNotifyTake = false;
 std::unordered_set<TaskHandle_t> g_liveTasks;
+std::vector<TaskHandle_t> g_pendingTasks;
+std::vector<FakeTimer *> g_timers;
+
+// Per thread, so a test can run tasks on a second thread that plays the other core.
+thread_local TaskHandle_t g_currentTaskHandle = nullptr;
+thread_local BaseType_t g_currentCore = 0;
+
+TaskHandle_t registerTask(FakeTask *fakeTask) {
+	TaskHandle_t handle = reinterpret_cast<TaskHandle_t>(fakeTask);
+	{
+		std::lock_guard<std::mutex> guard(g_taskMutex);
+		g_liveTasks.insert(handle);
+		g_pendingTasks.push_back(handle);
+	}
+	g_createdTasks.fetch_add(1, std::memory_order_relaxed);
+	return handle;
+}
 
-TaskHandle_t g_currentTaskHandle = nullptr;
+void destroyFakeTask(FakeTask *fakeTask) {
+	if (fakeTask->isStatic) {
+		fakeTask->~FakeTask();
+	} else {
+		delete fakeTask;
+	}
+}
 
 } // namespace
 
@@ -36,8 +105,13 @@ extern "C" unsigned long millis(void) {
 	return static_cast<unsigned long>(g_tickCount.load(std::memory_order_relaxed));
 }
 
-extern "C" SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t * /*buffer*/) {
-	auto *sem = new (std::nothrow) FakeSemaphore{};
+static_assert(sizeof(FakeSemaphore) <= sizeof(StaticSemaphore_t), "FakeSemaphore must fit");
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+	if (!buffer) {
+		return nullptr;
+	}
+	auto *sem = new (buffer) FakeSemaphore{};
 	return reinterpret_cast<SemaphoreHandle_t>(sem);
 }
 
@@ -64,7 +138,9 @@ extern "C" BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
 
 extern "C" void vSemaphoreDelete(SemaphoreHandle_t handle) {
 	auto *sem = reinterpret_cast<FakeSemaphore *>(handle);
-	delete sem;
+	if (sem) {
+		sem->~FakeSemaphore();
+	}
 }
 
 extern "C" BaseType_t xTaskCreatePinnedToCore(
@@ -72,27 +148,49 @@ extern "C" BaseType_t xTaskCreatePinnedToCore(
     const char * /*name*/,
     uint32_t /*stackDepth*/,
     void *parameters,
-    UBaseType_t /*priority*/,
+    UBaseType_t priority,
     TaskHandle_t *createdTask,
     BaseType_t /*coreId*/
 ) {
-	auto *fakeTask = new (std::nothrow) FakeTask{task, parameters};
-	if (!fakeTask) {
+	StubAllocationScope scope;
+	size_t failing = g_failingTaskCreates.load(std::memory_order_relaxed);
+	if (failing > 0) {
+		g_failingTaskCreates.store(failing - 1, std::memory_order_relaxed);
 		return pdFAIL;
 	}
+	failing = g_failingTaskAllocations.load(std::memory_order_relaxed);
+	if (failing > 0) {
+		g_failingTaskAllocations.store(failing - 1, std::memory_order_relaxed);
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
+	auto *fakeTask = new (std::nothrow) FakeTask{task, parameters, false, false, priority};
+	if (!fakeTask) {
+		return errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	}
 
-	TaskHandle_t handle = reinterpret_cast<TaskHandle_t>(fakeTask);
+	TaskHandle_t handle = registerTask(fakeTask);
 	if (createdTask) {
 		*createdTask = handle;
 	}
+	return pdPASS;
+}
 
-	{
-		std::lock_guard<std::mutex> guard(g_taskMutex);
-		g_liveTasks.insert(handle);
+extern "C" TaskHandle_t xTaskCreateStaticPinnedToCore(
+    TaskFunction_t task,
+    const char * /*name*/,
+    uint32_t /*stackDepth*/,
+    void *parameters,
+    UBaseType_t priority,
+    StackType_t *stackBuffer,
+    StaticTask_t *taskBuffer,
+    BaseType_t /*coreId*/
+) {
+	if (!stackBuffer || !taskBuffer) {
+		return nullptr;
 	}
-
-	g_createdTasks.fetch_add(1, std::memory_order_relaxed);
-	return pdPASS;
+	StubAllocationScope scope;
+	auto *fakeTask = new (taskBuffer) FakeTask{task, parameters, true, false, priority};
+	return registerTask(fakeTask);
 }
 
 extern "C" void vTaskDelete(TaskHandle_t task) {
@@ -105,13 +203,39 @@ extern "C" void vTaskDelete(TaskHandle_t task) {
 	{
 		std::lock_guard<std::mutex> guard(g_taskMutex);
 		removed = g_liveTasks.erase(target) > 0;
+		g_pendingTasks.erase(
+		    std::remove(g_pendingTasks.begin(), g_pendingTasks.end(), target),
+		    g_pendingTasks.end()
+		);
 	}
 
 	if (removed) {
 		g_deletedTasks.fetch_add(1, std::memory_order_relaxed);
-		auto *fakeTask = reinterpret_cast<FakeTask *>(target);
-		delete fakeTask;
+		destroyFakeTask(reinterpret_cast<FakeTask *>(target));
+	}
+}
+
+extern "C" void vTaskSuspend(TaskHandle_t task) {
+	TaskHandle_t target = task ? task : g_currentTaskHandle;
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (target && g_liveTasks.count(target) > 0) {
+		reinterpret_cast<FakeTask *>(target)->suspended = true;
+		g_pendingTasks.erase(
+		    std::remove(g_pendingTasks.begin(), g_pendingTasks.end(), target),
+		    g_pendingTasks.end()
+		);
+	}
+}
+
+extern "C" eTaskState eTaskGetState(TaskHandle_t task) {
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (!task || g_liveTasks.count(task) == 0) {
+		return eDeleted;
 	}
+	if (task == g_currentTaskHandle) {
+		return eRunning;
+	}
+	return reinterpret_cast<FakeTask *>(task)->suspended ? eSuspended : eReady;
 }
 
 extern "C" void vTaskDelay(TickType_t ticks) {
@@ -126,7 +250,156 @@ extern "C" TaskHandle_t xTaskGetCurrentTaskHandle(void) {
 	return g_currentTaskHandle;
 }
 
+extern "C" void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+	TaskHandle_t target = task ? task : g_currentTaskHandle;
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (target && g_liveTasks.count(target) > 0) {
+		reinterpret_cast<FakeTask *>(target)->priority = priority;
+	}
+}
+
+extern "C" UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+	TaskHandle_t target = task ? task : g_currentTaskHandle;
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (!target || g_liveTasks.count(target) == 0) {
+		return 0;
+	}
+	return reinterpret_cast<FakeTask *>(target)->priority;
+}
+
+extern "C" BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (!task || g_liveTasks.count(task) == 0) {
+		return pdFAIL;
+	}
+	reinterpret_cast<FakeTask *>(task)->notifications++;
+	g_taskNotified.notify_all();
+	return pdPASS;
+}
+
+extern "C" void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) {
+	if (xTaskNotifyGive(task) == pdPASS && higherPriorityTaskWoken) {
+		*higherPriorityTaskWoken = pdTRUE;
+	}
+}
+
+extern "C" uint32_t ulTaskGetRunTimeCounter(TaskHandle_t task) {
+	for (int core = 0; core < portNUM_PROCESSORS; ++core) {
+		if (task == &g_idleTasks[core]) {
+			return g_idleRunTime[core].load(std::memory_order_relaxed);
+		}
+	}
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (!task || g_liveTasks.count(task) == 0) {
+		return 0;
+	}
+	return reinterpret_cast<FakeTask *>(task)->runTime;
+}
+
+extern "C" TaskHandle_t xTaskGetIdleTaskHandleForCore(BaseType_t coreId) {
+	if (coreId < 0 || coreId >= portNUM_PROCESSORS) {
+		return nullptr;
+	}
+	return &g_idleTasks[coreId];
+}
+
+extern "C" uint32_t stubRunTimeCounterValue(void) {
+	return g_runTimeCounter.load(std::memory_order_relaxed);
+}
+
+// Tasks run to completion on the host, so a wait that finds no notification does not block: it
+// advances the tick count by the timeout as if the full wait had elapsed. With
+// setBlockingNotifyTake() a task's portMAX_DELAY wait blocks until another thread notifies it.
+extern "C" uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticks) {
+	{
+		std::unique_lock<std::mutex> lock(g_taskMutex);
+		if (g_currentTaskHandle && g_liveTasks.count(g_currentTaskHandle) > 0) {
+			auto *fakeTask = reinterpret_cast<FakeTask *>(g_currentTaskHandle);
+			if (g_blockingNotifyTake && ticks == portMAX_DELAY) {
+				g_taskNotified.wait(lock, [&]() { return fakeTask->notifications > 0; });
+			}
+			uint32_t value = fakeTask->notifications;
+			if (value > 0) {
+				fakeTask->notifications = clearCountOnExit ? 0 : value - 1;
+				return value;
+			}
+		}
+	}
+	if (ticks != portMAX_DELAY) {
+		g_tickCount.fetch_add(ticks, std::memory_order_relaxed);
+	}
+	return 0;
+}
+
+extern "C" TimerHandle_t xTimerCreate(
+    const char * /*name*/,
+    TickType_t period,
+    UBaseType_t autoReload,
+    void *timerId,
+    TimerCallbackFunction_t callback
+) {
+	StubAllocationScope scope;
+	auto *timer = new (std::nothrow) FakeTimer{period, autoReload != 0, timerId, callback};
+	if (!timer) {
+		return nullptr;
+	}
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	g_timers.push_back(timer);
+	return timer;
+}
+
+extern "C" BaseType_t xTimerChangePeriod(TimerHandle_t handle, TickType_t period, TickType_t) {
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	auto *timer = static_cast<FakeTimer *>(handle);
+	if (!timer || period == 0) {
+		return pdFAIL;
+	}
+	timer->period = period;
+	timer->active = true;
+	timer->expiry = g_tickCount.load(std::memory_order_relaxed) + period;
+	return pdPASS;
+}
+
+extern "C" BaseType_t xTimerStop(TimerHandle_t handle, TickType_t) {
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	auto *timer = static_cast<FakeTimer *>(handle);
+	if (!timer) {
+		return pdFAIL;
+	}
+	timer->active = false;
+	return pdPASS;
+}
+
+extern "C" BaseType_t xTimerDelete(TimerHandle_t handle, TickType_t) {
+	StubAllocationScope scope;
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	auto *timer = static_cast<FakeTimer *>(handle);
+	auto it = std::find(g_timers.begin(), g_timers.end(), timer);
+	if (it == g_timers.end()) {
+		return pdFAIL;
+	}
+	g_timers.erase(it);
+	delete timer;
+	return pdPASS;
+}
+
+extern "C" void *pvTimerGetTimerID(TimerHandle_t handle) {
+	auto *timer = static_cast<FakeTimer *>(handle);
+	return timer ? timer->id : nullptr;
+}
+
+extern "C" BaseType_t xPortGetCoreID(void) {
+	return g_currentCore;
+}
+
 extern "C" void *heap_caps_malloc(size_t size, unsigned int /*caps*/) {
+	size_t failing = g_failingHeapCapsAllocations.load(std::memory_order_relaxed);
+	while (failing > 0) {
+		if (g_failingHeapCapsAllocations.compare_exchange_weak(failing, failing - 1)) {
+			return nullptr;
+		}
+	}
+	g_heapCapsAllocations.fetch_add(1, std::memory_order_relaxed);
 	return std::malloc(size);
 }
 
@@ -138,19 +411,45 @@ extern "C" size_t heap_caps_get_total_size(unsigned int /*caps*/) {
 	return 0;
 }
 
+extern "C" size_t heap_caps_get_free_size(unsigned int caps) {
+	return (caps & MALLOC_CAP_SPIRAM) ? g_psramFree.load(std::memory_order_relaxed)
+	                                  : g_internalFree.load(std::memory_order_relaxed);
+}
+
+extern "C" size_t heap_caps_get_largest_free_block(unsigned int caps) {
+	return (caps & MALLOC_CAP_SPIRAM) ? g_psramFree.load(std::memory_order_relaxed)
+	                                  : g_internalLargestBlock.load(std::memory_order_relaxed);
+}
+
 namespace test_support {
 
 void resetRuntime() {
+	StubAllocationScope scope;
 	g_tickCount.store(0, std::memory_order_relaxed);
+	g_heapCapsAllocations.store(0, std::memory_order_relaxed);
+	setHeapFree(kDefaultInternalFree, kDefaultInternalLargestBlock, 0);
+	g_operatorNewAllocations.store(0, std::memory_order_relaxed);
 	g_createdTasks.store(0, std::memory_order_relaxed);
 	g_deletedTasks.store(0, std::memory_order_relaxed);
+	g_failingTaskCreates.store(0, std::memory_order_relaxed);
+	g_failingTaskAllocations.store(0, std::memory_order_relaxed);
+	g_failingHeapCapsAllocations.store(0, std::memory_order_relaxed);
+	g_runTimeCounter.store(0, std::memory_order_relaxed);
+	for (auto &idle : g_idleRunTime) {
+		idle.store(0, std::memory_order_relaxed);
+	}
 
 	std::lock_guard<std::mutex> guard(g_taskMutex);
+	g_blockingNotifyTake = false;
 	for (TaskHandle_t handle : g_liveTasks) {
-		auto *fakeTask = reinterpret_cast<FakeTask *>(handle);
-		delete fakeTask;
+		destroyFakeTask(reinterpret_cast<FakeTask *>(handle));
 	}
 	g_liveTasks.clear();
+	g_pendingTasks.clear();
+	for (FakeTimer *timer : g_timers) {
+		delete timer;
+	}
+	g_timers.clear();
 }
 
 size_t createdTaskCount() {
@@ -161,4 +460,115 @@ size_t deletedTaskCount() {
 	return g_deletedTasks.load(std::memory_order_relaxed);
 }
 
+size_t heapCapsAllocationCount() {
+	return g_heapCapsAllocations.load(std::memory_order_relaxed);
+}
+
+void recordOperatorNew() {
+	if (g_allocationTrackingPaused == 0) {
+		g_operatorNewAllocations.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+size_t operatorNewCount() {
+	return g_operatorNewAllocations.load(std::memory_order_relaxed);
+}
+
+void failNextTaskCreates(size_t count) {
+	g_failingTaskCreates.store(count, std::memory_order_relaxed);
+}
+
+void failNextTaskAllocations(size_t count) {
+	g_failingTaskAllocations.store(count, std::memory_order_relaxed);
+}
+
+void failNextHeapCapsAllocations(size_t count) {
+	g_failingHeapCapsAllocations.store(count, std::memory_order_relaxed);
+}
+
+void consumeCpu(uint32_t us) {
+	g_runTimeCounter.fetch_add(us, std::memory_order_relaxed);
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	if (g_currentTaskHandle && g_liveTasks.count(g_currentTaskHandle) > 0) {
+		reinterpret_cast<FakeTask *>(g_currentTaskHandle)->runTime += us;
+	}
+}
+
+void setBlockingNotifyTake(bool blocking) {
+	std::lock_guard<std::mutex> guard(g_taskMutex);
+	g_blockingNotifyTake = blocking;
+}
+
+void setCurrentCore(BaseType_t core) {
+	g_currentCore = core;
+}
+
+void addIdleRunTime(BaseType_t core, uint32_t us) {
+	if (core >= 0 && core < portNUM_PROCESSORS) {
+		g_idleRunTime[core].fetch_add(us, std::memory_order_relaxed);
+	}
+}
+
+void setHeapFree(size_t internalFree, size_t internalLargestBlock, size_t psramFree) {
+	g_internalFree.store(internalFree, std::memory_order_relaxed);
+	g_internalLargestBlock.store(internalLargestBlock, std::memory_order_relaxed);
+	g_psramFree.store(psramFree, std::memory_order_relaxed);
+}
+
+size_t runPendingTasks() {
+	size_t ran = 0;
+	while (true) {
+		TaskHandle_t handle = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(g_taskMutex);
+			if (g_pendingTasks.empty()) {
+				break;
+			}
+			handle = g_pendingTasks.front();
+			g_pendingTasks.erase(g_pendingTasks.begin());
+		}
+
+		auto *fakeTask = reinterpret_cast<FakeTask *>(handle);
+		TaskFunction_t entry = fakeTask->entry;
+		void *arg = fakeTask->arg;
+
+		TaskHandle_t previous = g_currentTaskHandle;
+		g_currentTaskHandle = handle;
+		if (entry) {
+			entry(arg);
+		}
+		g_currentTaskHandle = previous;
+		ran++;
+	}
+	return ran;
+}
+
+size_t advanceTicks(TickType_t ticks) {
+	TickType_t now = g_tickCount.fetch_add(ticks, std::memory_order_relaxed) + ticks;
+	size_t fired = 0;
+	while (true) {
+		FakeTimer *due = nullptr;
+		{
+			std::lock_guard<std::mutex> guard(g_taskMutex);
+			for (FakeTimer *timer : g_timers) {
+				if (timer->active && static_cast<int32_t>(now - timer->expiry) >= 0) {
+					due = timer;
+					break;
+				}
+			}
+			if (!due) {
+				break;
+			}
+			if (due->autoReload) {
+				due->expiry += due->period;
+			} else {
+				due->active = false;
+			}
+		}
+		due->callback(due);
+		fired++;
+	}
+	return fired;
+}
+
 } // namespace test_support